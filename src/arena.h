@@ -0,0 +1,43 @@
+/* arena.h - Region (arena) allocator built on the heap and page frames */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "types.h"
+
+#define ARENA_ALIGN       4     // Default alignment of arena_alloc
+
+/* A bump-pointer region; everything in it is freed at once */
+typedef struct Arena {
+    const char* name;
+    uint8_t* base;          // First usable byte
+    size_t size;            // Usable bytes
+    size_t top;             // Bytes in use
+    size_t peak;            // High-water mark of top
+    int pages;              // >0 if backed by page frames (freed on destroy)
+    struct Arena* next;     // Registry of live arenas
+} Arena;
+
+/* Checkpoint returned by arena_mark() */
+typedef size_t ArenaMark;
+
+/* Named kernel arenas with their own heap block (live forever) */
+int arena_init(Arena* a, const char* name, size_t size);
+Arena* arena_find(const char* name);
+
+/* Page-backed arena, header stored in its own first page */
+Arena* arena_create(const char* name, int pages);
+void arena_destroy(Arena* a);
+
+/* Allocation */
+void* arena_alloc(Arena* a, size_t size);
+void* arena_alloc_aligned(Arena* a, size_t size, size_t align);
+
+/* Checkpoints */
+ArenaMark arena_mark(Arena* a);
+void arena_release(Arena* a, ArenaMark mark);
+void arena_reset(Arena* a);
+
+void arena_print_all(void);
+void stress_test_arena(void);
+
+#endif
@@ -0,0 +1,466 @@
+/* bench.c - In-kernel microbenchmarks */
+#include "bench.h"
+#include "cpu.h"
+#include "memory.h"
+#include "process.h"
+#include "serial.h"
+#include "string.h"
+#include "scheduler.h"
+#include "pmm.h"
+
+#define SPAWN_BATCH   4     // Processes alive at once per round
+#define SPAWN_ROUNDS  500
+
+/* Entry point for benchmark processes (never actually scheduled) */
+static void bench_noop(void)
+{
+}
+
+/* Print "  <label>: <value> <unit>\n" */
+static void report(const char *label, uint32_t value, const char *unit)
+{
+    serial_puts("  ");
+    serial_puts(label);
+    serial_puts(": ");
+    serial_putdec(value);
+    serial_puts(unit);
+    serial_puts("\n");
+}
+
+/* Spawn and terminate SPAWN_BATCH processes per round, return cycles per pair */
+static uint32_t spawn_terminate_cycles(void)
+{
+    pid32 pids[SPAWN_BATCH];
+    uint32_t total = 0;
+    uint32_t pairs = 0;
+
+    for (int r = 0; r < SPAWN_ROUNDS; r++) {
+        uint32_t t0 = rdtsc();
+        for (int i = 0; i < SPAWN_BATCH; i++)
+            pids[i] = create_process_with_func(1, bench_noop);
+        for (int i = 0; i < SPAWN_BATCH; i++) {
+            if (pids[i] != -1) {
+                terminate_process(pids[i]);
+                pairs++;
+            }
+        }
+        total += rdtsc() - t0;
+    }
+
+    return pairs ? total / pairs : 0;
+}
+
+void bench_spawn_terminate(void)
+{
+    void *frag[6];
+    int saved = proc_use_stack_pool;
+
+    serial_puts("\n--- Spawn/Terminate Benchmark ---\n");
+
+    /* Leave some small live blocks so heap stacks see a realistic heap */
+    for (int i = 0; i < 6; i++)
+        frag[i] = heap_alloc(24 + i * 40);
+
+    proc_use_stack_pool = 0;
+    report("heap stacks", spawn_terminate_cycles(), " cycles/spawn+exit");
+
+    proc_use_stack_pool = 1;
+    report("pool stacks", spawn_terminate_cycles(), " cycles/spawn+exit");
+
+    proc_use_stack_pool = saved;
+    for (int i = 0; i < 6; i++)
+        heap_free(frag[i]);
+
+    serial_puts("--- Benchmark Complete ---\n\n");
+}
+
+#define STR_BUF_SIZE  4096
+#define STR_REPEAT    16
+
+static uint8_t str_src[STR_BUF_SIZE] __attribute__((aligned(16)));
+static uint8_t str_dst[STR_BUF_SIZE + 4] __attribute__((aligned(16)));
+
+/* Print cycles/byte with two decimals: "  <label> <size>B: N.NN cycles/byte" */
+static void report_per_byte(const char *label, size_t size, uint32_t cycles)
+{
+    uint32_t centi = (cycles * 100) / (size * STR_REPEAT);
+
+    serial_puts("  ");
+    serial_puts(label);
+    serial_puts(" ");
+    serial_putdec(size);
+    serial_puts("B: ");
+    serial_putdec(centi / 100);
+    serial_puts(".");
+    serial_putdec((centi / 10) % 10);
+    serial_putdec(centi % 10);
+    serial_puts(" cycles/byte\n");
+}
+
+/* The old per-char copy loop from send()/receive() */
+static void byte_copy(uint8_t *dst, const uint8_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        ((volatile uint8_t *)dst)[i] = src[i];
+}
+
+void bench_string(void)
+{
+    static const size_t sizes[] = { 16, 128, 1024, STR_BUF_SIZE };
+    uint32_t t0;
+
+    serial_puts("\n--- String/Memory Routine Benchmark ---\n");
+
+    for (size_t i = 0; i < STR_BUF_SIZE; i++)
+        str_src[i] = 'a' + (i % 26);
+
+    for (int s = 0; s < 4; s++) {
+        size_t n = sizes[s];
+
+        t0 = rdtsc();
+        for (int r = 0; r < STR_REPEAT; r++)
+            byte_copy(str_dst, str_src, n);
+        report_per_byte("byte loop   ", n, rdtsc() - t0);
+
+        t0 = rdtsc();
+        for (int r = 0; r < STR_REPEAT; r++)
+            memcpy(str_dst, str_src, n);
+        report_per_byte("memcpy      ", n, rdtsc() - t0);
+
+        t0 = rdtsc();
+        for (int r = 0; r < STR_REPEAT; r++)
+            memcpy(str_dst + 1, str_src, n);
+        report_per_byte("memcpy unal.", n, rdtsc() - t0);
+
+        t0 = rdtsc();
+        for (int r = 0; r < STR_REPEAT; r++)
+            memset(str_dst, r, n);
+        report_per_byte("memset      ", n, rdtsc() - t0);
+
+        str_src[n - 1] = '\0';
+        t0 = rdtsc();
+        for (int r = 0; r < STR_REPEAT; r++)
+            (void)strlen((const char *)str_src);
+        report_per_byte("strlen      ", n, rdtsc() - t0);
+        str_src[n - 1] = 'a' + ((n - 1) % 26);
+    }
+
+    serial_puts("--- Benchmark Complete ---\n\n");
+}
+
+#define SCHED_REPEAT  1000
+#define SCHED_PROCS   512   // Ready processes at the last step
+
+/* Ready-queue lengths measured, far enough for the linear scan's cost
+ * to pull away from the bitmap's */
+static const int sched_steps[] = { 1, 2, 4, 8, 64, SCHED_PROCS };
+
+/* The pre-bitmap SCHED_PRIO selection: walk the whole ready list */
+static pid32 linear_prio_pick(void)
+{
+    int slot, best_slot = -1;
+    int highest_prio = -1;
+
+    for (slot = sched_ready_head(cpu_self()->id); slot != -1; slot = proctab[slot]->next) {
+        if (proctab[slot]->prstate == PR_READY && proctab[slot]->prprio > highest_prio) {
+            highest_prio = proctab[slot]->prprio;
+            best_slot = slot;
+        }
+    }
+    return best_slot == -1 ? -1 : proctab[best_slot]->pid;
+}
+
+void bench_sched_decision(void)
+{
+    static pid32 pids[SCHED_PROCS];
+    int n = 0;
+    int saved_policy = sched_policy;
+
+    serial_puts("\n--- Scheduling Decision Benchmark (SCHED_PRIO) ---\n");
+    serial_puts("  ready\tbitmap\tlinear scan (cycles/decision)\n");
+
+    sched_policy = SCHED_PRIO;
+
+    /* Add ready processes up to each step; lowest priority last so the
+     * linear scan has to look at every entry. They are pinned here, so
+     * both pickers see all of them on this CPU's queue. */
+    for (unsigned s = 0; s < sizeof(sched_steps) / sizeof(sched_steps[0]); s++) {
+        while (n < sched_steps[s]) {
+            pids[n] = create_process_pinned(NPRIO - 1 - n % NPRIO, bench_noop);
+            if (pids[n] == -1)
+                break;
+            n++;
+        }
+        if (n < sched_steps[s])
+            break;      /* Out of slots or memory */
+
+        uint32_t t0 = rdtsc();
+        for (int r = 0; r < SCHED_REPEAT; r++)
+            (void)schedule_next();
+        uint32_t fast = (rdtsc() - t0) / SCHED_REPEAT;
+
+        t0 = rdtsc();
+        for (int r = 0; r < SCHED_REPEAT; r++)
+            (void)linear_prio_pick();
+        uint32_t slow = (rdtsc() - t0) / SCHED_REPEAT;
+
+        serial_puts("  ");
+        serial_putdec(n);
+        serial_puts("\t");
+        serial_putdec(fast);
+        serial_puts("\t");
+        serial_putdec(slow);
+        serial_puts("\n");
+    }
+
+    while (n > 0)
+        terminate_process(pids[--n]);
+
+    sched_policy = saved_policy;
+    serial_puts("--- Benchmark Complete ---\n\n");
+}
+
+#define SCAN_REPEAT     100
+#define SCAN_MAX_PROCS  1024
+
+/* pcb_t before the hot/cold split, field for field: the fields a table
+ * scan tests were spread over three cache lines of a 300-byte record */
+typedef struct {
+    pid32 pid;
+    int prgen, prstate, prprio;
+    char *prstkptr, *prstkbase;
+    int next, prev, prqnext, prqprev, prqlevel, prmqnext, prmqprev, prmlevel, prcpu;
+    int prtickets;
+    uint32_t prpass;
+    int prrt;
+    uint32_t prperiod, prbudget, prdeadline, prrelease, prabsdeadline, prbudgetleft;
+    int prjobover, prmisses, prrtnext, prrtprev;
+    int prsleepnext;
+    uint32_t prdelta;
+    void (*prfunc)(void);
+    int prquantum, prtime, original_prio;
+    uint32_t prready_since;
+    int prcputime;
+    uint8_t *prfpu;
+    int prfpucpu;
+    Message msg_inbox;
+    int has_msg;
+    pid32 sender_pid;
+    struct Arena *prarena;
+} whole_pcb_t;
+
+static pid32 scan_pids[SCAN_MAX_PROCS];
+static volatile int scan_sink;
+
+/* The tests work_pending() makes on each slot, over the whole table */
+static int scan_split(void)
+{
+    int n = 0;
+
+    for (int i = 0; i < proctab_slots; i++) {
+        int state = proctab[i]->prstate;
+        if (proctab[i]->prfunc != NULL && state == PR_READY)
+            n++;
+        if (proctab[i]->prrt && state == PR_WAITING)
+            n++;
+    }
+    return n;
+}
+
+static int scan_whole(whole_pcb_t *tab, int slots)
+{
+    int n = 0;
+
+    for (int i = 0; i < slots; i++) {
+        int state = tab[i].prstate;
+        if (tab[i].prfunc != NULL && state == PR_READY)
+            n++;
+        if (tab[i].prrt && state == PR_WAITING)
+            n++;
+    }
+    return n;
+}
+
+/* Cycles for one scan starting from empty caches, as a scan run once
+ * per tick finds them after the workload has run, averaged */
+static uint32_t cold_scan_cycles(whole_pcb_t *whole, int slots)
+{
+    uint32_t total = 0;
+
+    for (int r = 0; r < SCAN_REPEAT; r++) {
+        __asm__ volatile ("wbinvd" ::: "memory");
+        uint32_t t0 = rdtsc();
+        scan_sink = whole ? scan_whole(whole, slots) : scan_split();
+        total += rdtsc() - t0;
+    }
+    return total / SCAN_REPEAT;
+}
+
+void bench_pcb_scan(void)
+{
+    static const int steps[] = { 64, 256, SCAN_MAX_PROCS };
+    int n = 0;
+
+    serial_puts("\n--- PCB Scan Benchmark (cold cache) ---\n");
+    serial_puts("  slots\tsplit\twhole (cycles/scan)\n");
+
+    for (unsigned s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        while (n < steps[s]) {
+            scan_pids[n] = create_process(1);
+            if (scan_pids[n] == -1)
+                break;
+            n++;
+        }
+
+        /* The same table in the old one-record-per-PCB layout */
+        int slots = proctab_slots;
+        size_t pages = (slots * sizeof(whole_pcb_t) + PAGE_SIZE - 1) / PAGE_SIZE;
+        whole_pcb_t *whole = (whole_pcb_t *)pmm_alloc_frames(pages);
+        if (!whole)
+            break;
+        for (int i = 0; i < slots; i++) {
+            whole[i].prstate = proctab[i]->prstate;
+            whole[i].prfunc = proctab[i]->prfunc;
+            whole[i].prrt = proctab[i]->prrt;
+        }
+
+        uint32_t split = cold_scan_cycles(NULL, slots);
+        uint32_t joined = cold_scan_cycles(whole, slots);
+        pmm_free_frames(whole, pages);
+
+        serial_puts("  ");
+        serial_putdec(slots);
+        serial_puts("\t");
+        serial_putdec(split);
+        serial_puts("\t");
+        serial_putdec(joined);
+        serial_puts("\n");
+    }
+
+    while (n > 0)
+        terminate_process(scan_pids[--n]);
+
+    serial_puts("--- Benchmark Complete ---\n\n");
+}
+
+/* Switch samples of the current run; a sample is the time from one
+ * process handing over the CPU to the other one running */
+static uint32_t sw_samples[CTXSW_MAX_ROUNDS];
+static volatile int sw_count, sw_target;
+static volatile uint32_t sw_stamp;
+static volatile pid32 sw_stamp_pid;
+static pid32 sw_pids[2];
+
+/* Yield ping-pong: stamp, yield, and on resuming time the handover if
+ * the other process stamped last (a yield that switched nothing is
+ * not a sample) */
+static void bench_yield_proc(void)
+{
+    pid32 me = getpid();
+
+    while (sw_count < sw_target) {
+        sw_stamp_pid = me;
+        sw_stamp = rdtsc();
+        yield();
+        uint32_t now = rdtsc();
+        if (sw_stamp_pid != me && sw_count < sw_target)
+            sw_samples[sw_count++] = now - sw_stamp;
+    }
+}
+
+/* IPC ping-pong: each message carries its send time; the receiver
+ * polls, yielding while its inbox is empty, and answers at once */
+static void bench_ipc_proc(void)
+{
+    pid32 me = getpid();
+    pid32 peer = (me == sw_pids[0]) ? sw_pids[1] : sw_pids[0];
+    uint32_t stamp;
+
+    if (me == sw_pids[0]) {
+        stamp = rdtsc();
+        send(peer, (char *)&stamp, sizeof(stamp));
+    }
+
+    while (sw_count < sw_target) {
+        if (receive(peer, (char *)&stamp, sizeof(stamp)) != sizeof(stamp)) {
+            yield();
+            continue;
+        }
+        uint32_t now = rdtsc();
+        sw_samples[sw_count++] = now - stamp;
+        stamp = rdtsc();
+        send(peer, (char *)&stamp, sizeof(stamp));
+    }
+}
+
+/* Shell sort, ascending */
+static void sort_samples(uint32_t *a, int n)
+{
+    for (int gap = n / 2; gap > 0; gap /= 2) {
+        for (int i = gap; i < n; i++) {
+            uint32_t v = a[i];
+            int j = i;
+            while (j >= gap && a[j - gap] > v) {
+                a[j] = a[j - gap];
+                j -= gap;
+            }
+            a[j] = v;
+        }
+    }
+}
+
+/* Run two copies of 'body' to completion; print "min/median/p99".
+ * Both are pinned to this CPU, so they never run at the same time and
+ * share sw_count/sw_samples safely: every policy, RR included, only
+ * dispatches from a CPU's own run queue, and stealing skips pinned
+ * processes (SMP-2 checks this under RR). */
+static void ctxsw_run(void (*body)(void), int rounds)
+{
+    sw_count = 0;
+    sw_target = rounds;
+    sw_stamp_pid = -1;
+    sw_pids[0] = create_process_pinned(5, body);
+    sw_pids[1] = create_process_pinned(5, body);
+    sched_run();
+
+    int n = sw_count;
+    if (n == 0) {
+        serial_puts("-");
+        return;
+    }
+    sort_samples(sw_samples, n);
+    serial_putdec(sw_samples[0]);
+    serial_puts("/");
+    serial_putdec(sw_samples[n / 2]);
+    serial_puts("/");
+    serial_putdec(sw_samples[(n * 99) / 100]);
+}
+
+void bench_ctxsw(int rounds)
+{
+    static const int policies[] = { SCHED_RR, SCHED_PRIO, SCHED_MLFQ, SCHED_STRIDE };
+    static const char *names[] = { "RR    ", "PRIO  ", "MLFQ  ", "STRIDE" };
+    int saved_policy = sched_policy;
+
+    if (rounds > CTXSW_MAX_ROUNDS)
+        rounds = CTXSW_MAX_ROUNDS;
+
+    serial_puts("\n--- Context Switch Benchmark (");
+    serial_putdec(rounds);
+    serial_puts(" rounds) ---\n");
+    serial_puts("  policy\tyield min/med/p99\tIPC min/med/p99 (cycles)\n");
+
+    for (int p = 0; p < 4; p++) {
+        sched_policy = policies[p];
+        serial_puts("  ");
+        serial_puts(names[p]);
+        serial_puts("\t");
+        ctxsw_run(bench_yield_proc, rounds);
+        serial_puts("\t\t");
+        ctxsw_run(bench_ipc_proc, rounds);
+        serial_puts("\n");
+    }
+
+    sched_policy = saved_policy;
+    serial_puts("--- Benchmark Complete ---\n\n");
+}
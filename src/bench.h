@@ -0,0 +1,24 @@
+/* bench.h - In-kernel microbenchmarks */
+#ifndef BENCH_H
+#define BENCH_H
+
+/* Process spawn/terminate throughput: stack pool vs heap stacks */
+void bench_spawn_terminate(void);
+
+/* memcpy/memset/strlen cost in cycles per byte vs a byte loop */
+void bench_string(void);
+
+/* Cost of one SCHED_PRIO decision vs number of ready processes (1-512) */
+void bench_sched_decision(void);
+
+/* Cycles per scan over the process table, hot PCB halves vs whole
+ * PCBs in one array, as the table grows (the table keeps its size) */
+void bench_pcb_scan(void);
+
+/* Cycles per switch between two processes ping-ponging through yield()
+ * and through send()/receive(), min/median/p99 for every policy */
+#define CTXSW_DEFAULT_ROUNDS  1000
+#define CTXSW_MAX_ROUNDS      4096
+void bench_ctxsw(int rounds);
+
+#endif
@@ -0,0 +1,94 @@
+/* cpu.h - Low-level CPU helpers (timestamp counter, bit scans, cpuid, interrupts) */
+#ifndef CPU_H
+#define CPU_H
+
+#include "types.h"
+
+/* Read the CPU timestamp counter (low 32 bits are enough for short spans) */
+static inline uint32_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    (void)hi;
+    return lo;
+}
+
+/* Full 64-bit timestamp counter, for timestamps that must not wrap */
+static inline uint64_t rdtsc64(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Index of lowest set bit. Undefined for 0 - callers must check first. */
+static inline int bsf(uint32_t x) {
+    int ret;
+    __asm__ ("bsfl %1, %0" : "=r"(ret) : "rm"(x));
+    return ret;
+}
+
+/* Index of highest set bit. Undefined for 0 - callers must check first. */
+static inline int bsr(uint32_t x) {
+    int ret;
+    __asm__ ("bsrl %1, %0" : "=r"(ret) : "rm"(x));
+    return ret;
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+    __asm__ volatile ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+/* Disable interrupts, returning the previous EFLAGS for irq_restore() */
+static inline uint32_t irq_disable(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushfl; popl %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/* Re-enable interrupts only if they were enabled before irq_disable() */
+static inline void irq_restore(uint32_t flags) {
+    if (flags & 0x200)
+        __asm__ volatile ("sti" : : : "memory");
+}
+
+/* Control registers */
+#define CR0_MP          (1u << 1)   /* WAIT/FWAIT honour CR0.TS */
+#define CR0_EM          (1u << 2)   /* No FPU: FPU instructions trap */
+#define CR0_TS          (1u << 3)   /* Task switched: next FPU use raises #NM */
+#define CR0_NE          (1u << 5)   /* Native x87 error reporting */
+#define CR4_OSFXSR      (1u << 9)   /* FXSAVE/FXRSTOR and SSE enabled */
+#define CR4_OSXMMEXCPT  (1u << 10)  /* Unmasked SSE exceptions raise #XM */
+
+static inline uint32_t read_cr0(void) {
+    uint32_t v;
+    __asm__ volatile ("movl %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr0(uint32_t v) {
+    __asm__ volatile ("movl %0, %%cr0" : : "r"(v) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t v;
+    __asm__ volatile ("movl %%cr4, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr4(uint32_t v) {
+    __asm__ volatile ("movl %0, %%cr4" : : "r"(v) : "memory");
+}
+
+/* Clear / set CR0.TS */
+static inline void clts(void) {
+    __asm__ volatile ("clts" : : : "memory");
+}
+
+static inline void stts(void) {
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+static inline void irq_enable(void) {
+    __asm__ volatile ("sti" : : : "memory");
+}
+
+#endif
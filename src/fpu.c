@@ -0,0 +1,145 @@
+/* fpu.c - Lazy x87/SSE state switching (see fpu.h) */
+#include "fpu.h"
+#include "cpu.h"
+#include "idt.h"
+#include "process.h"
+#include "serial.h"
+#include "pmm.h"
+
+#define CPUID_FXSR      (1u << 24)  /* Leaf 1 EDX: FXSAVE/FXRSTOR */
+#define CPUID_SSE       (1u << 25)  /* Leaf 1 EDX: SSE */
+
+int fpu_available = 0;
+volatile uint32_t fpu_faults = 0;
+volatile uint32_t fpu_restores = 0;
+
+/* One save area per process slot, in pages of FPU_AREAS_PER_PAGE that
+ * are allocated when a slot in them first uses the FPU */
+#define FPU_AREAS_PER_PAGE  (PAGE_SIZE / FPU_AREA_SIZE)
+static uint8_t *fpu_pages[NPROC_MAX / FPU_AREAS_PER_PAGE];
+static spinlock_t fpu_lock = SPINLOCK_INIT;
+
+/* State right after FNINIT, loaded for a process's first FPU use */
+static uint8_t fpu_initial[FPU_AREA_SIZE] __attribute__((aligned(16)));
+
+/* Save area of a slot, NULL if no memory is left */
+static uint8_t *fpu_area(int slot)
+{
+    int page = slot / FPU_AREAS_PER_PAGE;
+
+    spin_lock(&fpu_lock);
+    if (!fpu_pages[page])
+        fpu_pages[page] = pmm_alloc_frame();
+    spin_unlock(&fpu_lock);
+
+    if (!fpu_pages[page])
+        return NULL;
+    return fpu_pages[page] + (slot % FPU_AREAS_PER_PAGE) * FPU_AREA_SIZE;
+}
+
+static inline void fxsave(uint8_t *area)
+{
+    __asm__ volatile ("fxsave (%0)" : : "r"(area) : "memory");
+}
+
+static inline void fxrstor(const uint8_t *area)
+{
+    __asm__ volatile ("fxrstor (%0)" : : "r"(area) : "memory");
+}
+
+/* #NM: the running process wants the FPU */
+static void fpu_nm_handler(int_frame_t *frame)
+{
+    cpu_t *cpu = cpu_self();
+    int slot = find_slot(cpu->cpu_currpid);
+    pcb_cold_t *c;
+
+    (void)frame;
+
+    if (!fpu_available) {
+        serial_puts("\n[PANIC] FPU used, but the CPU has no FXSAVE\n");
+        for (;;)
+            __asm__ volatile ("cli; hlt");
+    }
+
+    clts();
+    fpu_faults++;
+    cpu->fpu_live = 1;
+
+    if (slot == -1) {
+        /* Kernel context: scratch state, dropped at the next switch */
+        fxrstor(fpu_initial);
+        cpu->fpu_owner = -1;
+        return;
+    }
+
+    c = proccold[slot];
+    if (!c->prfpu) {
+        c->prfpu = fpu_area(slot);
+        if (!c->prfpu) {
+            serial_puts("\n[PANIC] No memory for FPU state\n");
+            for (;;)
+                __asm__ volatile ("cli; hlt");
+        }
+        fxrstor(fpu_initial);
+        fpu_restores++;
+    } else if (cpu->fpu_owner != slot || c->prfpucpu != cpu->id) {
+        /* Registers hold someone else's state, or an older copy of ours */
+        fxrstor(c->prfpu);
+        fpu_restores++;
+    }
+    cpu->fpu_owner = slot;
+    c->prfpucpu = cpu->id;
+}
+
+void fpu_save(int slot)
+{
+    cpu_t *cpu = cpu_self();
+
+    /* Owner first: prfpu is only looked at for an FPU user */
+    if (slot != -1 && cpu->fpu_owner == slot && proccold[slot]->prfpu)
+        fxsave(proccold[slot]->prfpu);
+    else
+        cpu->fpu_owner = -1;    /* Registers hold nobody's state */
+
+    cpu->fpu_live = 0;
+    stts();
+}
+
+void fpu_init(void)
+{
+    cpu_t *cpu = cpu_self();
+    uint32_t a, b, c, d;
+    uint32_t cr0;
+
+    cpuid(1, &a, &b, &c, &d);
+
+    cpu->fpu_owner = -1;
+    cpu->fpu_live = 0;
+
+    /* Without FXSAVE leave CR0.EM set: any FPU use then traps */
+    cr0 = read_cr0();
+    if (!(d & CPUID_FXSR)) {
+        write_cr0(cr0 | CR0_EM | CR0_TS);
+        if (cpu->id == 0) {
+            isr_register(EXC_DEVICE_NA, fpu_nm_handler);
+            serial_puts("[FPU] No FXSAVE support, FPU disabled\n");
+        }
+        return;
+    }
+
+    /* Native x87 errors (#MF), WAIT honours TS, no emulation */
+    write_cr0((cr0 & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+    write_cr4(read_cr4() | CR4_OSFXSR | ((d & CPUID_SSE) ? CR4_OSXMMEXCPT : 0));
+    __asm__ volatile ("fninit");
+
+    if (cpu->id == 0) {
+        fxsave(fpu_initial);
+        fpu_available = 1;
+        isr_register(EXC_DEVICE_NA, fpu_nm_handler);
+        serial_puts((d & CPUID_SSE) ? "[FPU] x87 + SSE, lazy switching\n"
+                                    : "[FPU] x87, lazy switching\n");
+    }
+
+    stts();
+}
@@ -0,0 +1,40 @@
+/* fpu.h - Lazy x87/SSE state switching
+ *
+ * CR0.TS is kept set while the FPU registers do not belong to the
+ * running process. Its first FPU or SSE instruction raises #NM, and
+ * only then is its state loaded (FXRSTOR) into the registers. A process
+ * that used the FPU has its state saved (FXSAVE) when it is switched
+ * out, so the state can follow it to another CPU. Processes that never
+ * touch the FPU cost one flag test per switch.
+ */
+#ifndef FPU_H
+#define FPU_H
+
+#include "types.h"
+#include "smp.h"
+
+#define FPU_AREA_SIZE   512     /* FXSAVE image, 16-byte aligned */
+
+/* 1 once fpu_init() found FXSAVE/FXRSTOR support */
+extern int fpu_available;
+
+/* #NM faults taken and FXRSTORs they needed, for the statistics */
+extern volatile uint32_t fpu_faults;
+extern volatile uint32_t fpu_restores;
+
+/* Enable the FPU and SSE on this CPU with CR0.TS set; the BSP also
+ * installs the #NM handler */
+void fpu_init(void);
+
+/* Save the FPU state of the process in 'slot' (-1 = not a process)
+ * and set CR0.TS again (interrupts off) */
+void fpu_save(int slot);
+
+/* Called before every context switch on this CPU */
+static inline void fpu_switch_out(int slot)
+{
+    if (cpu_self()->fpu_live)
+        fpu_save(slot);
+}
+
+#endif
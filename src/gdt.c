@@ -0,0 +1,71 @@
+/* gdt.c - Global descriptor table with per-CPU segments
+ *
+ * Code and data are flat 4 GB segments. Each CPU additionally gets a
+ * small data segment based at its cpus[] entry and loaded into %fs, so
+ * cpu_self() is a single load from %fs:0.
+ */
+#include "gdt.h"
+#include "smp.h"
+
+#define GDT_ENTRIES     (GDT_CPU_BASE + MAX_CPUS)
+
+typedef struct gdt_entry {
+    uint16_t limit_low;
+    uint16_t base_low;
+    uint8_t base_mid;
+    uint8_t access;
+    uint8_t granularity;    /* Flags (high nibble) and limit 19:16 */
+    uint8_t base_high;
+} __attribute__((packed)) gdt_entry_t;
+
+typedef struct gdt_ptr {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) gdt_ptr_t;
+
+static gdt_entry_t gdt[GDT_ENTRIES];
+
+static void gdt_set(int i, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
+    gdt[i].limit_low = limit & 0xFFFF;
+    gdt[i].base_low = base & 0xFFFF;
+    gdt[i].base_mid = (base >> 16) & 0xFF;
+    gdt[i].access = access;
+    gdt[i].granularity = (flags & 0xF0) | ((limit >> 16) & 0x0F);
+    gdt[i].base_high = (base >> 24) & 0xFF;
+}
+
+void gdt_init(void) {
+    gdt_set(0, 0, 0, 0, 0);
+    gdt_set(1, 0, 0xFFFFF, 0x9A, 0xC0);     /* Ring 0 code, 4 KB granular */
+    gdt_set(2, 0, 0xFFFFF, 0x92, 0xC0);     /* Ring 0 data */
+
+    for (int i = 0; i < MAX_CPUS; i++) {
+        cpus[i].self = &cpus[i];
+        cpus[i].id = i;
+        cpus[i].cpu_currpid = -1;
+        cpus[i].fpu_owner = -1;
+        gdt_set(GDT_CPU_BASE + i, (uint32_t)&cpus[i], sizeof(cpu_t) - 1, 0x92, 0x40);
+    }
+
+    gdt_load(0);
+}
+
+void gdt_load(int cpu) {
+    gdt_ptr_t ptr;
+    uint16_t fs = (GDT_CPU_BASE + cpu) << 3;
+
+    ptr.limit = sizeof(gdt) - 1;
+    ptr.base = (uint32_t)gdt;
+
+    __asm__ volatile (
+        "lgdt %0\n\t"
+        "ljmp %1, $1f\n"
+        "1:\n\t"
+        "movw %w2, %%ds\n\t"
+        "movw %w2, %%es\n\t"
+        "movw %w2, %%ss\n\t"
+        "movw %w2, %%gs\n\t"
+        "movw %w3, %%fs"
+        : : "m"(ptr), "i"(GDT_KERNEL_CODE), "r"(GDT_KERNEL_DATA), "r"(fs)
+        : "memory");
+}
@@ -0,0 +1,16 @@
+/* gdt.h - Global descriptor table */
+#ifndef GDT_H
+#define GDT_H
+
+#define GDT_KERNEL_CODE 0x08
+#define GDT_KERNEL_DATA 0x10
+#define GDT_CPU_BASE    3       /* First per-CPU %fs descriptor */
+
+/* Build the GDT (flat code/data plus one %fs segment per CPU) and load
+ * it on the bootstrap CPU */
+void gdt_init(void);
+
+/* Load the GDT on the calling CPU and select its %fs segment */
+void gdt_load(int cpu);
+
+#endif
@@ -0,0 +1,159 @@
+/* idt.c - Interrupt descriptor table, 8259 PIC and interrupt dispatch */
+#include "idt.h"
+#include "io.h"
+#include "serial.h"
+#include "lapic.h"
+
+/* 8259 PIC ports */
+#define PIC1_CMD    0x20
+#define PIC1_DATA   0x21
+#define PIC2_CMD    0xA0
+#define PIC2_DATA   0xA1
+#define PIC_EOI     0x20
+
+/* 32-bit interrupt gate, present, ring 0 */
+#define IDT_GATE_INT32  0x8E
+
+typedef struct idt_entry {
+    uint16_t offset_low;
+    uint16_t selector;
+    uint8_t zero;
+    uint8_t type_attr;
+    uint16_t offset_high;
+} __attribute__((packed)) idt_entry_t;
+
+typedef struct idt_ptr {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) idt_ptr_t;
+
+extern uint32_t isr_stub_table[NUM_STUBS];     /* From isr.S */
+extern void isr_spurious(void);
+
+static idt_entry_t idt[IDT_ENTRIES];
+static int_handler_t handlers[NUM_STUBS];
+
+static const char* exception_names[32] = {
+    "Divide error", "Debug", "NMI", "Breakpoint", "Overflow",
+    "Bound range", "Invalid opcode", "Device not available",
+    "Double fault", "Coprocessor overrun", "Invalid TSS",
+    "Segment not present", "Stack fault", "General protection",
+    "Page fault", "Reserved", "x87 FPU error", "Alignment check",
+    "Machine check", "SIMD exception", "Virtualization",
+    "Control protection", "Reserved", "Reserved", "Reserved",
+    "Reserved", "Reserved", "Reserved", "Reserved", "Reserved",
+    "Security exception", "Reserved"
+};
+
+static void idt_set_gate(int vector, uint32_t handler, uint16_t selector) {
+    idt[vector].offset_low = handler & 0xFFFF;
+    idt[vector].selector = selector;
+    idt[vector].zero = 0;
+    idt[vector].type_attr = IDT_GATE_INT32;
+    idt[vector].offset_high = (handler >> 16) & 0xFFFF;
+}
+
+/* Move IRQ 0-15 off the CPU exception vectors and mask them all */
+static void pic_remap(void) {
+    outb(PIC1_CMD, 0x11);           /* ICW1: init, expect ICW4 */
+    outb(PIC2_CMD, 0x11);
+    outb(PIC1_DATA, IRQ_BASE);      /* ICW2: vector offsets */
+    outb(PIC2_DATA, IRQ_BASE + 8);
+    outb(PIC1_DATA, 0x04);          /* ICW3: slave on IRQ2 */
+    outb(PIC2_DATA, 0x02);
+    outb(PIC1_DATA, 0x01);          /* ICW4: 8086 mode */
+    outb(PIC2_DATA, 0x01);
+
+    outb(PIC1_DATA, 0xFB);          /* Everything masked but the cascade */
+    outb(PIC2_DATA, 0xFF);
+}
+
+void irq_mask(int irq) {
+    uint16_t port = (irq < 8) ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) | (1 << (irq & 7)));
+}
+
+void irq_unmask(int irq) {
+    uint16_t port = (irq < 8) ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) & ~(1 << (irq & 7)));
+}
+
+void idt_init(void) {
+    uint16_t cs;
+
+    /* Gates use whatever code segment the kernel is running in */
+    __asm__ volatile ("mov %%cs, %0" : "=r"(cs));
+
+    for (int i = 0; i < NUM_STUBS; i++) {
+        idt_set_gate(i, isr_stub_table[i], cs);
+        handlers[i] = NULL;
+    }
+    idt_set_gate(LAPIC_SPURIOUS_VECTOR, (uint32_t)isr_spurious, cs);
+
+    pic_remap();
+    idt_load();
+}
+
+void idt_load(void) {
+    idt_ptr_t ptr;
+
+    ptr.limit = sizeof(idt) - 1;
+    ptr.base = (uint32_t)idt;
+    __asm__ volatile ("lidt %0" : : "m"(ptr));
+}
+
+void isr_register(int vector, int_handler_t handler) {
+    if (vector >= 0 && vector < NUM_STUBS &&
+        (vector < IRQ_BASE || vector >= IRQ_BASE + 16))
+        handlers[vector] = handler;
+}
+
+void irq_register(int irq, int_handler_t handler) {
+    if (irq < 0 || irq >= 16)
+        return;
+    handlers[IRQ_BASE + irq] = handler;
+    irq_unmask(irq);
+}
+
+/* Called from isr_common with interrupts disabled */
+void isr_dispatch(int_frame_t* frame) {
+    uint32_t vec = frame->int_no;
+
+    if (vec >= IRQ_BASE + 16) {
+        /* Local APIC interrupt: acknowledged at the APIC */
+        lapic_eoi();
+        if (handlers[vec])
+            handlers[vec](frame);
+        return;
+    }
+
+    if (vec >= IRQ_BASE) {
+        /* Acknowledge first: the handler may switch to another process
+         * (preemption) and not come back here for a long time */
+        if (vec >= IRQ_BASE + 8)
+            outb(PIC2_CMD, PIC_EOI);
+        outb(PIC1_CMD, PIC_EOI);
+
+        if (handlers[vec])
+            handlers[vec](frame);
+        return;
+    }
+
+    if (handlers[vec]) {
+        handlers[vec](frame);
+        return;
+    }
+
+    /* Unhandled CPU exception: report and stop */
+    serial_puts("\n[PANIC] ");
+    serial_puts(exception_names[vec]);
+    serial_puts(" (vector ");
+    serial_putdec(vec);
+    serial_puts(", error ");
+    serial_puthex(frame->err_code);
+    serial_puts(") at EIP ");
+    serial_puthex(frame->eip);
+    serial_puts("\n");
+    for (;;)
+        __asm__ volatile ("cli; hlt");
+}
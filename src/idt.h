@@ -0,0 +1,41 @@
+/* idt.h - Interrupt descriptor table, PIC and interrupt dispatch */
+#ifndef IDT_H
+#define IDT_H
+
+#include "types.h"
+
+#define IDT_ENTRIES     256
+#define NUM_STUBS       49      /* 32 exceptions + 16 IRQs + APIC timer */
+#define IRQ_BASE        32      /* PIC IRQ 0 is remapped to this vector */
+
+/* Exception vectors we handle specially */
+#define EXC_DEVICE_NA   7       /* #NM: FPU used while CR0.TS is set */
+
+/* Local APIC vectors (acknowledged at the APIC, not the PIC) */
+#define LAPIC_TIMER_VECTOR      48
+#define LAPIC_SPURIOUS_VECTOR   0xFF
+
+/* Register state pushed by isr.S (lowest address first) */
+typedef struct int_frame {
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;   /* pushal */
+    uint32_t int_no;
+    uint32_t err_code;
+    uint32_t eip, cs, eflags;                           /* pushed by CPU */
+} int_frame_t;
+
+typedef void (*int_handler_t)(int_frame_t* frame);
+
+void idt_init(void);
+
+/* Load the (shared) IDT on an application processor */
+void idt_load(void);
+
+/* Install a C handler for a CPU exception (0-31) or APIC vector */
+void isr_register(int vector, int_handler_t handler);
+
+/* Install a handler for a PIC IRQ line (0-15) and unmask it */
+void irq_register(int irq, int_handler_t handler);
+void irq_mask(int irq);
+void irq_unmask(int irq);
+
+#endif
@@ -3,10 +3,24 @@
 #include "serial.h"
 #include "string.h"
 #include "memory.h"
+#include "pmm.h"
+#include "arena.h"
 #include "process.h"
 #include "scheduler.h"
+#include "bench.h"
+#include "cpu.h"
+#include "idt.h"
+#include "timer.h"
+#include "gdt.h"
+#include "smp.h"
+#include "trace.h"
+#include "fpu.h"
 
 #define MAX_INPUT 128
+#define IPC_ARENA_SIZE (4 * MSG_SIZE)
+
+/* Scratch space for IPC receive buffers, rewound after each use */
+static Arena ipc_arena;
 
 /* Forward declare exit function */
 extern void user_process_exit(void);
@@ -65,26 +79,404 @@ void process3(void)
     user_process_exit();
 }
 
-void kmain(void)
+/* CPU-bound processes for the preemption test: neither ever yields,
+ * so they can only interleave if the timer tick takes the CPU away */
+volatile int spin_a = 0;
+volatile int spin_b = 0;
+volatile int spin_b_seen = 0;
+
+#define SPIN_TICKS 6
+
+static int own_cputime(void)
+{
+    return proctab[find_slot(getpid())]->prcputime;
+}
+
+void spin_process_a(void)
+{
+    while (own_cputime() < SPIN_TICKS)
+        spin_a++;
+    spin_b_seen = spin_b;   /* B ran while A was still unfinished */
+}
+
+void spin_process_b(void)
+{
+    while (own_cputime() < SPIN_TICKS)
+        spin_b++;
+}
+
+/* Minimum-stack test: two busy loops on STACK_MIN stacks preempt each
+ * other, so the timer path runs on both stacks; each records its own
+ * peak before it exits */
+volatile size_t minstk_peak[2];
+
+static void minstk_spin(int i)
+{
+    while (own_cputime() < SPIN_TICKS)
+        ;
+    minstk_peak[i] = get_stack_peak(getpid());
+}
+
+void minstk_process_a(void)
+{
+    minstk_spin(0);
+}
+
+void minstk_process_b(void)
+{
+    minstk_spin(1);
+}
+
+/* MLFQ test: a batch job that never yields and an interactive one that
+ * first spins until it is demoted, then yields after every short burst,
+ * which moves it back up. All 200 bursts together must stay well under
+ * MLFQ_ALLOTMENT(0) ticks for it to keep the top level. */
+#define MLFQ_BATCH_TICKS 16
+
+volatile int mlfq_batch_level = -1;
+volatile int mlfq_inter_demoted = -1;
+volatile int mlfq_inter_level = -1;
+volatile int mlfq_batch_done = 0;
+volatile int mlfq_inter_saw_batch_done = 1;
+
+void mlfq_batch_process(void)
+{
+    while (own_cputime() < MLFQ_BATCH_TICKS);
+    mlfq_batch_level = proctab[find_slot(getpid())]->prmlevel;
+    mlfq_batch_done = 1;
+}
+
+void mlfq_interactive_process(void)
+{
+    while (proctab[find_slot(getpid())]->prmlevel == 0);
+    mlfq_inter_demoted = proctab[find_slot(getpid())]->prmlevel;
+
+    for (int i = 0; i < 200; i++) {
+        for (volatile int work = 0; work < 100; work++);
+        yield();
+    }
+    mlfq_inter_level = proctab[find_slot(getpid())]->prmlevel;
+    mlfq_inter_saw_batch_done = mlfq_batch_done;
+}
+
+/* Stride test: CPU-bound processes with 3:2:1 tickets share one CPU
+ * for STRIDE_TEST_TICKS, then report the CPU time they got */
+#define STRIDE_TEST_TICKS 120
+
+static const int stride_tickets[3] = { 300, 200, 100 };
+volatile uint32_t stride_start = 0;
+volatile int stride_cputime[3];
+
+void stride_process(void)
+{
+    int tickets = get_tickets(getpid());
+    int i;
+
+    while (timer_ticks - stride_start < STRIDE_TEST_TICKS);
+
+    for (i = 0; i < 3; i++) {
+        if (stride_tickets[i] == tickets)
+            stride_cputime[i] = own_cputime();
+    }
+}
+
+/* EDF test: two periodic real-time processes doing a fixed amount of
+ * work per job next to a higher-priority CPU hog */
+#define EDF_JOBS 5
+
+volatile int edf_jobs = 0;
+volatile int edf_misses = 0;
+volatile int edf_finished = 0;
+
+static void edf_run_jobs(int work)
+{
+    for (int job = 0; job < EDF_JOBS; job++) {
+        int until = own_cputime() + work;
+        while (own_cputime() < until);
+        edf_jobs++;
+        rt_wait_period();
+    }
+    edf_misses += get_deadline_misses(getpid());
+    edf_finished++;
+}
+
+void edf_control_process(void)
+{
+    edf_run_jobs(2);    /* Budget 3 every 10 ticks */
+}
+
+void edf_logger_process(void)
+{
+    edf_run_jobs(4);    /* Budget 5 every 20 ticks */
+}
+
+void edf_hog_process(void)
+{
+    while (edf_finished < 2);
+}
+
+/* FPU test: two processes keep a running sum in an x87 register, each
+ * with its own rounding mode, while preemption switches between them */
+#define FPU_TEST_TICKS 20
+
+volatile int fpu_ok[2];
+
+static void fpu_worker(int idx, double step, uint16_t cw)
+{
+    uint32_t start = timer_ticks;
+    uint32_t n = 0;
+    uint16_t cw_seen;
+    double acc = 0.0;
+
+    __asm__ volatile ("fldcw %0" : : "m"(cw));
+    while (timer_ticks - start < FPU_TEST_TICKS) {
+        acc += step;
+        n++;
+    }
+    __asm__ volatile ("fnstcw %0" : "=m"(cw_seen));
+
+    /* Sums of powers of two are exact in any rounding mode */
+    fpu_ok[idx] = (n > 0 && acc == n * step && cw_seen == cw);
+}
+
+void fpu_process_a(void)
+{
+    fpu_worker(0, 0.5, 0x077F);     /* Round down */
+}
+
+void fpu_process_b(void)
+{
+    fpu_worker(1, 0.25, 0x0F7F);    /* Round toward zero */
+}
+
+/* Sleep test: three processes sleep 30, 10 and 20 ticks; each records
+ * when it woke and in which order */
+static const uint32_t sleep_ticks[3] = { 30, 10, 20 };
+volatile uint32_t sleep_start = 0;
+volatile uint32_t sleep_woke[3];
+volatile int sleep_order[3];
+volatile int sleep_nwoke = 0;
+volatile int sleep_ready_seen = -1;
+
+static void sleeper(int idx)
+{
+    sleep(sleep_ticks[idx]);
+    sleep_woke[idx] = timer_ticks - sleep_start;
+    if (sleep_nwoke == 0)
+        sleep_ready_seen = get_num_ready();     /* The others still sleep */
+    sleep_order[sleep_nwoke++] = idx;
+}
+
+void sleeper_a(void) { sleeper(0); }
+void sleeper_b(void) { sleeper(1); }
+void sleeper_c(void) { sleeper(2); }
+
+/* SMP test: CPU-bound workers, each recording the CPU it finished on */
+#define SMP_WORK_TICKS 10
+
+volatile uint32_t smp_cpu_mask = 0;
+
+void smp_worker(void)
+{
+    uint32_t mask;
+
+    while (own_cputime() < SMP_WORK_TICKS);
+
+    mask = irq_disable();
+    __sync_fetch_and_or(&smp_cpu_mask, 1u << cpu_self()->id);
+    irq_restore(mask);
+}
+
+/* Pinned to CPU 0: counts every time it finds itself anywhere else */
+volatile int smp_pinned_strays = 0;
+
+void smp_pinned_worker(void)
+{
+    uint32_t mask;
+
+    while (own_cputime() < SMP_WORK_TICKS) {
+        mask = irq_disable();
+        if (cpu_self()->id != 0)
+            smp_pinned_strays++;
+        irq_restore(mask);
+    }
+}
+
+/* Boot command line (QEMU -append "..."), copied before the page-frame
+ * allocator can reuse the memory the loader left it in */
+#define BOOT_CMDLINE_MAX 256
+static char boot_cmdline[BOOT_CMDLINE_MAX];
+
+static void save_cmdline(uint32_t magic, multiboot_info_t* mbi)
+{
+    const char* p;
+    int n = 0;
+
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC && (mbi->flags & MULTIBOOT_INFO_CMDLINE)) {
+        p = (const char*)mbi->cmdline;
+        while (p[n] && n < BOOT_CMDLINE_MAX - 1) {
+            boot_cmdline[n] = p[n];
+            n++;
+        }
+    }
+    boot_cmdline[n] = '\0';
+}
+
+/* Check the boot command line for a word */
+static int boot_option(const char* opt)
+{
+    const char* p = boot_cmdline;
+
+    while (*p) {
+        const char* o = opt;
+        while (*p == ' ')
+            p++;
+        while (*o && *p == *o) {
+            p++;
+            o++;
+        }
+        if (*o == '\0' && (*p == ' ' || *p == '\0'))
+            return 1;
+        while (*p && *p != ' ')
+            p++;
+    }
+    return 0;
+}
+
+/* Digits past this stop counting, so boot values can't overflow and
+ * still fit an int; callers clamp to their own limits */
+#define BOOT_VALUE_MAX 100000000
+
+/* Numeric boot option "name=N"; returns 'def' when absent */
+static uint32_t boot_value(const char* name, uint32_t def)
+{
+    const char* p = boot_cmdline;
+
+    while (*p) {
+        const char* n = name;
+        while (*p == ' ')
+            p++;
+        while (*n && *p == *n) {
+            p++;
+            n++;
+        }
+        if (*n == '\0' && *p == '=' && p[1] >= '0' && p[1] <= '9') {
+            uint32_t v = 0;
+            for (p++; *p >= '0' && *p <= '9'; p++) {
+                if (v <= BOOT_VALUE_MAX)
+                    v = v * 10 + (*p - '0');
+            }
+            return v;
+        }
+        while (*p && *p != ' ')
+            p++;
+    }
+    return def;
+}
+
+/* Shell commands */
+static void run_command(const char* input)
+{
+    if (strcmp(input, "help") == 0) {
+        serial_puts("Commands:\n");
+        serial_puts("  meminfo  - heap, page-frame and arena statistics\n");
+        serial_puts("  trace    - dump the scheduler trace (trace clear: reset it)\n");
+        serial_puts("  stacks   - peak stack use of every process\n");
+        serial_puts("  sched    - scheduler, real-time and process statistics\n");
+        serial_puts("  ctxbench - context switch benchmark (ctxbench N: N rounds)\n");
+        serial_puts("  help     - this list\n");
+    }
+    else if (strcmp(input, "meminfo") == 0) {
+        heap_print_stats();
+        pmm_print_info();
+        arena_print_all();
+    }
+    else if (strcmp(input, "trace") == 0) {
+        trace_dump();
+    }
+    else if (strcmp(input, "trace clear") == 0) {
+        trace_clear();
+    }
+    else if (strcmp(input, "stacks") == 0) {
+        print_stacks();
+    }
+    else if (strcmp(input, "sched") == 0) {
+        print_scheduler_stats();
+    }
+    else if (strcmp(input, "ctxbench") == 0) {
+        bench_ctxsw(CTXSW_DEFAULT_ROUNDS);
+    }
+    else if (memcmp(input, "ctxbench ", 9) == 0) {
+        /* Exactly one decimal count, 1..CTXSW_MAX_ROUNDS */
+        const char* p = input + 9;
+        int rounds = 0;
+        while (*p >= '0' && *p <= '9' && rounds <= CTXSW_MAX_ROUNDS)
+            rounds = rounds * 10 + (*p++ - '0');
+        if (p == input + 9 || *p != '\0' || rounds < 1 || rounds > CTXSW_MAX_ROUNDS) {
+            serial_puts("usage: ctxbench [N], N from 1 to ");
+            serial_putdec(CTXSW_MAX_ROUNDS);
+            serial_puts("\n");
+        } else {
+            bench_ctxsw(rounds);
+        }
+    }
+    else {
+        /* Echo back the input */
+        serial_puts("You typed: ");
+        serial_puts(input);
+        serial_puts("\n");
+    }
+}
+
+void kmain(uint32_t magic, multiboot_info_t* mbi)
 {
 
     char input[MAX_INPUT];
     int pos = 0;
 
+    /* Own GDT first: per-CPU state (currpid) is reached through %fs */
+    gdt_init();
+
+    /* Before anything can allocate over the loader's copy */
+    save_cmdline(magic, mbi);
+
     /* Initialize hardware */
     serial_init();
 
     /* Initialize memory manager */
     memory_init();
 
+    /* Initialize page-frame allocator from the multiboot memory map */
+    pmm_init(magic, mbi);
+    pmm_print_info();
+
+    /* Heap engine can be chosen at boot: -append "heap=buddy" */
+    if (boot_option("heap=buddy")) {
+        heap_set_engine(HEAP_ENGINE_BUDDY);
+        serial_puts("[Memory] Using buddy heap engine\n");
+    }
+
     /* Initialize process table */
     init_proctab();
     
     /* Initialize scheduler */
     sched_init();
 
+    /* Interrupts and the scheduler tick: -append "hz=N" sets the rate */
+    idt_init();
+    fpu_init();
+    timer_init(boot_value("hz", TIMER_HZ));
+    serial_puts("[Timer] PIT at ");
+    serial_putdec(timer_get_hz());
+    serial_puts(" Hz\n");
+    irq_enable();
+
     // stress test
     stress_test_memory();
+    stress_test_arena();
+
+    if (arena_init(&ipc_arena, "ipc", IPC_ARENA_SIZE) != 0)
+        serial_puts("[Memory] Could not create the IPC arena\n");
 
     // /* Test stack allocation */
     // void* stack_ptr = stack_alloc(64);
@@ -175,7 +567,7 @@ void kmain(void)
     else {
         /* next_proc is actually a slot index, need to convert to PID */
         int next_slot = next_proc;
-        pid32 next_pid = proctab[next_slot].pid;
+        pid32 next_pid = proctab[next_slot]->pid;
         set_current(next_pid);
         if (get_process_state(p1) != 2)  // PR_CURR = 2
             test6_pass = 0;
@@ -204,6 +596,47 @@ void kmain(void)
     if (get_stack_base(p1) != NULL)  // Terminated process should have NULL
         test10_pass = 0;
 
+    /* Test 11: Table grows well past its first page of PCBs */
+    pid32 many[64];
+    int test11_pass = 1;
+    int ready_before = get_num_ready();
+    for (int i = 0; i < 64; i++) {
+        many[i] = create_process(1);
+        if (many[i] == -1 || get_process_state(many[i]) != PR_READY)
+            test11_pass = 0;
+    }
+    if (proctab_slots < 64 || get_num_ready() != ready_before + 64)
+        test11_pass = 0;
+    for (int i = 0; i < 64; i++)
+        terminate_process(many[i]);
+    if (get_num_ready() != ready_before)
+        test11_pass = 0;
+
+    /* Test 12: Old PIDs do not find a reused slot */
+    int test12_pass = 1;
+    pid32 reused = create_process(1);
+    if (reused == -1 || find_slot(reused) == -1)
+        test12_pass = 0;
+    for (int i = 0; i < 64; i++) {
+        if (many[i] == reused || is_valid_pid(many[i]))
+            test12_pass = 0;
+    }
+    terminate_process(reused);
+
+    /* Test 13: Per-process stack size, painted so only the switch
+     * frame (5 words) counts as used before the process runs */
+    int test13_pass = 1;
+    pid32 big = create_process_with_stack(1, process1, 2000);
+    if (big == -1 || get_stack_size(big) != 2000 || get_stack_peak(big) != 5 * 4)
+        test13_pass = 0;
+    if (get_stack_size(p2) != STACK_PER_PROC)
+        test13_pass = 0;
+    if (create_process_with_stack(1, process1, STACK_MIN - 1) != -1)
+        test13_pass = 0;
+    if (create_process_with_stack(1, process1, (size_t)-8) != -1)
+        test13_pass = 0;    /* Would round up to 0 */
+    terminate_process(big);
+
     /* Print results */
     serial_puts("\n========================================\n");
     serial_puts("    Process Manager Utility Tests\n");
@@ -239,10 +672,20 @@ void kmain(void)
     serial_puts("Test 10 (Stack Allocation): ");
     serial_puts(test10_pass ? "PASS\n" : "FAIL\n");
 
+    serial_puts("Test 11 (Table Growth): ");
+    serial_puts(test11_pass ? "PASS\n" : "FAIL\n");
+
+    serial_puts("Test 12 (Stale PID Lookup): ");
+    serial_puts(test12_pass ? "PASS\n" : "FAIL\n");
+
+    serial_puts("Test 13 (Stack Size and Peak): ");
+    serial_puts(test13_pass ? "PASS\n" : "FAIL\n");
+
     /* Overall result */
     int all_pass = test1_pass && test2_pass && test3_pass && test4_pass && 
                    test5_pass && test6_pass && test7_pass && test8_pass && 
-                   test9_pass && test10_pass;
+                   test9_pass && test10_pass && test11_pass && test12_pass &&
+                   test13_pass;
 
     serial_puts("\n");
     serial_puts(all_pass ? "All tests PASSED!\n" : "Some tests FAILED!\n");
@@ -273,19 +716,19 @@ void kmain(void)
 
     /* Test message was set in receiver's inbox */
     int receiver_slot = find_slot(receiver);
-    int msg_received = proctab[receiver_slot].has_msg;
+    int msg_received = proccold[receiver_slot]->has_msg;
     int ipc_test3 = (msg_received == 1) ? 1 : 0;
     serial_puts("Test IPC-3 (Message Available): ");
     serial_puts(ipc_test3 ? "PASS\n" : "FAIL\n");
 
     /* Test message sender field is correct */
-    int sender_correct = (proctab[receiver_slot].msg_inbox.sender_pid == sender);
+    int sender_correct = (proccold[receiver_slot]->msg_inbox.sender_pid == sender);
     int ipc_test4 = sender_correct ? 1 : 0;
     serial_puts("Test IPC-4 (Sender Identification): ");
     serial_puts(ipc_test4 ? "PASS\n" : "FAIL\n");
 
     /* Test message length is correct */
-    int msg_len = proctab[receiver_slot].msg_inbox.len;
+    int msg_len = proccold[receiver_slot]->msg_inbox.len;
     int ipc_test5 = (msg_len == 10) ? 1 : 0;
     serial_puts("Test IPC-5 (Message Length): ");
     serial_puts(ipc_test5 ? "PASS\n" : "FAIL\n");
@@ -293,7 +736,7 @@ void kmain(void)
     /* Test message content */
     int content_match = 1;
     for (int i = 0; i < 10; i++) {
-        if (proctab[receiver_slot].msg_inbox.data[i] != test_msg[i])
+        if (proccold[receiver_slot]->msg_inbox.data[i] != test_msg[i])
             content_match = 0;
     }
     int ipc_test6 = content_match ? 1 : 0;
@@ -302,14 +745,16 @@ void kmain(void)
 
     /* Now test receive() function with src_pid parameter */
     /* First reset the message and set receiver as current */
-    proctab[receiver_slot].has_msg = 1;  /* Reset has_msg */
+    proccold[receiver_slot]->has_msg = 1;  /* Reset has_msg */
     set_current(receiver);  /* Set receiver as current process */
     
-    char rcv_buffer[128];
-    int rcv_result = receive(sender, rcv_buffer, 128);
+    ArenaMark ipc_mark = arena_mark(&ipc_arena);
+    char *rcv_buffer = arena_alloc(&ipc_arena, MSG_SIZE);
+    int rcv_result = rcv_buffer ? receive(sender, rcv_buffer, MSG_SIZE) : -1;
     int ipc_test7 = (rcv_result == 10) ? 1 : 0;
     serial_puts("Test IPC-7 (Receive with Sender Check): ");
     serial_puts(ipc_test7 ? "PASS\n" : "FAIL\n");
+    arena_release(&ipc_arena, ipc_mark);
 
     /* Overall IPC result */
     int ipc_all_pass = ipc_test1 && ipc_test2 && ipc_test3 && ipc_test4 && 
@@ -338,9 +783,9 @@ void kmain(void)
     int slot1 = find_slot(proc1);
     int slot2 = find_slot(proc2);
     int slot3 = find_slot(proc3);
-    int sched_test2 = (proctab[slot1].prfunc == process1 &&
-                       proctab[slot2].prfunc == process2 &&
-                       proctab[slot3].prfunc == process3) ? 1 : 0;
+    int sched_test2 = (proctab[slot1]->prfunc == process1 &&
+                       proctab[slot2]->prfunc == process2 &&
+                       proctab[slot3]->prfunc == process3) ? 1 : 0;
     serial_puts("Test SCHED-2 (Function Pointers Set): ");
     serial_puts(sched_test2 ? "PASS\n" : "FAIL\n");
     
@@ -363,21 +808,267 @@ void kmain(void)
     serial_puts("Test SCHED-5 (Priority Selection): ");
     serial_puts(sched_test5 ? "PASS\n" : "FAIL\n");
     
+    /* Test 6: Aging - each AGING_THRESHOLD of waiting adds AGING_BOOST */
+    for (int i = 0; i < 2 * AGING_THRESHOLD; i++)
+        apply_aging();
+    int sched_test6 = (get_effective_priority(proc3) == 1 + 2 * AGING_BOOST &&
+                       get_process_priority(proc3) == 1 &&
+                       schedule_next() == proc1) ? 1 : 0;
+    for (int i = 0; i < 20 * AGING_THRESHOLD; i++)
+        apply_aging();
+    sched_test6 = sched_test6 && (get_effective_priority(proc3) == AGING_PRIO_CAP);
+    serial_puts("Test SCHED-6 (Lazy Aging): ");
+    serial_puts(sched_test6 ? "PASS\n" : "FAIL\n");
+    
     /* Overall scheduler test result */
     int sched_all_pass = sched_test1 && sched_test2 && sched_test3 && 
-                         sched_test4 && sched_test5;
+                         sched_test4 && sched_test5 && sched_test6;
     
     serial_puts("\n");
     serial_puts(sched_all_pass ? "All Scheduler tests PASSED!\n" : "Some Scheduler tests FAILED!\n");
     serial_puts("========================================\n\n");
     
-    serial_puts("NOTE: Scheduler fully functional. Context switching not\n");
-    serial_puts("      demonstrated to avoid blocking the shell.\n\n");
-    
     /* Clean up test processes */
     terminate_process(proc1);
     terminate_process(proc2);
     terminate_process(proc3);
+    terminate_process(p2);
+    terminate_process(p3);
+    terminate_process(sender);
+    terminate_process(receiver);
+
+    /* ============= PREEMPTION TEST ============= */
+    serial_puts("========================================\n");
+    serial_puts("    Preemption Tests\n");
+    serial_puts("========================================\n\n");
+
+    uint32_t tick0 = timer_ticks;
+    for (volatile uint32_t spin = 0; spin < 50000000 && timer_ticks == tick0; spin++);
+    int preempt_test1 = (timer_ticks != tick0);
+    serial_puts("Test PREEMPT-1 (Timer Ticks Advancing): ");
+    serial_puts(preempt_test1 ? "PASS\n" : "FAIL\n");
+
+    /* Two equal-priority busy loops with a 2-tick quantum */
+    int preempt_test2 = 0;
+    if (preempt_test1) {
+        pid32 spa = create_process_with_func(4, spin_process_a);
+        pid32 spb = create_process_with_func(4, spin_process_b);
+        set_quantum(spa, 2);
+        set_quantum(spb, 2);
+        sched_run();
+        preempt_test2 = (spin_a > 0 && spin_b_seen > 0);
+    }
+    serial_puts("Test PREEMPT-2 (Time Slicing Without Yield): ");
+    serial_puts(preempt_test2 ? "PASS\n" : "FAIL\n");
+
+    /* MLFQ: the batch job uses up its allotment at each level and sinks
+     * to the bottom; the interactive one is demoted once, climbs back
+     * by yielding early, stays on top and finishes while the batch job
+     * is still busy */
+    int mlfq_test = 0;
+    if (preempt_test1) {
+        int saved_policy = sched_policy;
+        sched_policy = SCHED_MLFQ;
+        create_process_with_func(1, mlfq_batch_process);
+        create_process_with_func(1, mlfq_interactive_process);
+        sched_run();
+        sched_policy = saved_policy;
+        mlfq_test = (mlfq_batch_level == MLFQ_LEVELS - 1 && mlfq_inter_demoted == 1 &&
+                     mlfq_inter_level == 0 && !mlfq_inter_saw_batch_done);
+    }
+    serial_puts("Test PREEMPT-3 (MLFQ Demotion/Promotion): ");
+    serial_puts(mlfq_test ? "PASS\n" : "FAIL\n");
+
+    /* Stride: observed CPU shares within 2 ticks of the ticket ratio */
+    int stride_test = 0;
+    if (preempt_test1) {
+        int saved_policy = sched_policy;
+        int total_tickets = 0, total_time = 0;
+
+        sched_policy = SCHED_STRIDE;
+        stride_start = timer_ticks;
+        for (int i = 0; i < 3; i++) {
+            set_tickets(create_process_with_func(1, stride_process), stride_tickets[i]);
+            total_tickets += stride_tickets[i];
+        }
+        sched_run();
+        sched_policy = saved_policy;
+
+        for (int i = 0; i < 3; i++)
+            total_time += stride_cputime[i];
+        stride_test = (total_time > 0);
+        serial_puts("  CPU ticks for 300:200:100 tickets =");
+        for (int i = 0; i < 3; i++) {
+            int expected = total_time * stride_tickets[i];
+            int observed = stride_cputime[i] * total_tickets;
+            int diff = observed > expected ? observed - expected : expected - observed;
+            if (diff > 2 * total_tickets)
+                stride_test = 0;
+            serial_puts(" ");
+            serial_putdec(stride_cputime[i]);
+        }
+        serial_puts("\n");
+    }
+    serial_puts("Test PREEMPT-4 (Stride Shares Converge): ");
+    serial_puts(stride_test ? "PASS\n" : "FAIL\n");
+
+    /* EDF: 30% + 25% is admitted, another 50% is not; every job meets
+     * its deadline although a priority-20 hog wants the CPU throughout */
+    int edf_test = 0;
+    if (preempt_test1) {
+        pid32 hog = create_process_with_func(20, edf_hog_process);
+        int admitted =
+            set_realtime(create_process_with_func(1, edf_control_process), 10, 3, 0) == 0 &&
+            set_realtime(create_process_with_func(1, edf_logger_process), 20, 5, 0) == 0;
+        int rejected = (set_realtime(hog, 10, 5, 0) == -1);
+
+        sched_run();
+        edf_test = (admitted && rejected && edf_jobs == 2 * EDF_JOBS && edf_misses == 0);
+    }
+    serial_puts("Test PREEMPT-5 (EDF Admission and Deadlines): ");
+    serial_puts(edf_test ? "PASS\n" : "FAIL\n");
+
+    /* Lazy FPU: no process so far touched the FPU, so none took a #NM;
+     * two FPU users keep their own registers across preemption */
+    int fpu_test = 0;
+    if (preempt_test1 && fpu_available) {
+        uint32_t faults_before = fpu_faults;
+        pid32 fa = create_process_with_func(4, fpu_process_a);
+        pid32 fb = create_process_with_func(4, fpu_process_b);
+        set_quantum(fa, 2);
+        set_quantum(fb, 2);
+        sched_run();
+        serial_puts("  #NM faults: ");
+        serial_putdec(fpu_faults);
+        serial_puts(", state restores: ");
+        serial_putdec(fpu_restores);
+        serial_puts("\n");
+        fpu_test = (faults_before == 0 && fpu_ok[0] && fpu_ok[1] && fpu_restores > 2);
+    }
+    serial_puts("Test PREEMPT-6 (Lazy FPU Context Switch): ");
+    serial_puts(fpu_test ? "PASS\n" : "FAIL\n");
+
+    /* Sleep: shortest sleeper wakes first, each within a tick or two of
+     * its due time, and sleepers are not on the ready list */
+    int sleep_test = 0;
+    if (preempt_test1) {
+        sleep_start = timer_ticks;
+        create_process_with_func(1, sleeper_a);
+        create_process_with_func(1, sleeper_b);
+        create_process_with_func(1, sleeper_c);
+        sched_run();
+
+        sleep_test = (sleep_nwoke == 3 && sleep_order[0] == 1 && sleep_order[1] == 2 &&
+                      sleep_order[2] == 0 && sleep_ready_seen == 0);
+        for (int i = 0; i < 3; i++) {
+            if (sleep_woke[i] < sleep_ticks[i] || sleep_woke[i] > sleep_ticks[i] + 2)
+                sleep_test = 0;
+        }
+    }
+    serial_puts("Test PREEMPT-7 (Sleep Queue Wake-Up): ");
+    serial_puts(sleep_test ? "PASS\n" : "FAIL\n");
+
+    /* Minimum stacks survive preemption: the painted base of each stack
+     * is still intact after several timer-driven switches */
+    int minstk_test = 0;
+    if (preempt_test1) {
+        pid32 ma = create_process_with_stack(4, minstk_process_a, STACK_MIN);
+        pid32 mb = create_process_with_stack(4, minstk_process_b, STACK_MIN);
+        if (ma != -1 && mb != -1) {
+            set_quantum(ma, 1);
+            set_quantum(mb, 1);
+            sched_run();
+            serial_puts("  peak stack use: ");
+            serial_putdec(minstk_peak[0]);
+            serial_puts(", ");
+            serial_putdec(minstk_peak[1]);
+            serial_puts(" of ");
+            serial_putdec(STACK_MIN);
+            serial_puts(" bytes\n");
+            minstk_test = (minstk_peak[0] > 0 && minstk_peak[0] < STACK_MIN &&
+                           minstk_peak[1] > 0 && minstk_peak[1] < STACK_MIN);
+        }
+    }
+    serial_puts("Test PREEMPT-8 (Minimum Stack Under Preemption): ");
+    serial_puts(minstk_test ? "PASS\n" : "FAIL\n");
+    serial_puts("========================================\n\n");
+
+    /* Process spawn/terminate throughput */
+    bench_spawn_terminate();
+
+    /* memcpy/memset/strlen vs byte loops */
+    bench_string();
+
+    /* Priority-bitmap scheduling decision cost, up to 512 ready
+     * processes, on request: -append "schedbench" (grows the process
+     * table to that size for good) */
+    if (boot_option("schedbench"))
+        bench_sched_decision();
+
+    /* Process table scan cost, split vs whole PCBs, on request:
+     * -append "scanbench" (grows the table to 1024 slots for good) */
+    if (boot_option("scanbench"))
+        bench_pcb_scan();
+
+    /* Yield/IPC ping-pong switch cost, on request: -append "ctxbench"
+     * or "ctxbench=N" for N rounds (one CPU, before the APs start) */
+    int ctx_rounds = boot_value("ctxbench", 0);
+    if (boot_option("ctxbench"))
+        ctx_rounds = CTXSW_DEFAULT_ROUNDS;
+    if (ctx_rounds > 0)
+        bench_ctxsw(ctx_rounds);
+
+    /* Application processors (QEMU -smp N); they idle in the scheduler */
+    smp_init();
+
+    /* Workers spread over every CPU, by placement and work stealing
+     * (they measure their work in ticks, so only with a working timer) */
+    int nworkers = 2 * ncpus;
+    uint32_t smp_start = timer_ticks;
+    if (preempt_test1) {
+        for (int i = 0; i < nworkers; i++)
+            create_process_with_func(1, smp_worker);
+        sched_run();
+    }
+    uint32_t smp_elapsed = timer_ticks - smp_start;
+
+    int cpus_used = 0;
+    for (int i = 0; i < MAX_CPUS; i++)
+        cpus_used += (smp_cpu_mask >> i) & 1;
+
+    serial_puts("[SMP] ");
+    serial_putdec(nworkers);
+    serial_puts(" workers x ");
+    serial_putdec(SMP_WORK_TICKS);
+    serial_puts(" ticks finished in ");
+    serial_putdec(smp_elapsed);
+    serial_puts(" ticks on ");
+    serial_putdec(cpus_used);
+    serial_puts(" CPU(s)\n");
+    serial_puts("Test SMP-1 (Work On Every CPU): ");
+    serial_puts(cpus_used == ncpus ? "PASS\n" : "FAIL\n");
+
+    /* The same under Round-Robin, which picks from each CPU's own
+     * arrival queue, plus pinned workers that must stay on CPU 0 */
+    int rr_smp_test = 0;
+    if (preempt_test1) {
+        int saved_policy = sched_policy;
+        sched_policy = SCHED_RR;
+        smp_cpu_mask = 0;
+        for (int i = 0; i < nworkers; i++) {
+            create_process_with_func(1, smp_worker);
+            create_process_pinned(1, smp_pinned_worker);
+        }
+        sched_run();
+        sched_policy = saved_policy;
+
+        cpus_used = 0;
+        for (int i = 0; i < MAX_CPUS; i++)
+            cpus_used += (smp_cpu_mask >> i) & 1;
+        rr_smp_test = (cpus_used == ncpus && smp_pinned_strays == 0);
+    }
+    serial_puts("Test SMP-2 (Round-Robin Per-CPU Queues): ");
+    serial_puts(rr_smp_test ? "PASS\n" : "FAIL\n");
 
     /* Running null process */
     serial_puts("Running shell...\n\n");
@@ -414,13 +1105,8 @@ void kmain(void)
             }
         }
 
-        /* Echo back the input */
         if (pos > 0)
-        {
-            serial_puts("You typed: ");
-            serial_puts(input);
-            serial_puts("\n");
-        }
+            run_command(input);
     }
 
     /* Should never reach here */
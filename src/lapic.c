@@ -0,0 +1,110 @@
+/* lapic.c - Local APIC driver
+ *
+ * Paging is off, so the registers are accessed at their physical
+ * address. The PIT keeps driving the bootstrap CPU's tick through the
+ * 8259; application processors tick from their own APIC timer.
+ */
+#include "lapic.h"
+#include "cpu.h"
+#include "idt.h"
+#include "timer.h"
+#include "scheduler.h"
+
+/* Register offsets */
+#define LAPIC_ID        0x020
+#define LAPIC_TPR       0x080
+#define LAPIC_EOI       0x0B0
+#define LAPIC_SVR       0x0F0
+#define LAPIC_ICR_LO    0x300
+#define LAPIC_ICR_HI    0x310
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_TIMER_INIT 0x380
+#define LAPIC_TIMER_CUR 0x390
+#define LAPIC_TIMER_DIV 0x3E0
+
+#define SVR_ENABLE      0x100
+#define ICR_PENDING     0x1000
+#define ICR_INIT_ALL    0x000C4500  /* INIT, assert, all excluding self */
+#define ICR_SIPI_ALL    0x000C4600  /* Start-up, all excluding self */
+#define LVT_MASKED      0x10000
+#define LVT_PERIODIC    0x20000
+#define TIMER_DIV_16    0x3
+
+#define CALIBRATE_TICKS 5
+
+static uint32_t lapic_timer_count = 0;  /* APIC timer counts per PIT tick */
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return *(volatile uint32_t*)(LAPIC_BASE + reg);
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t val) {
+    *(volatile uint32_t*)(LAPIC_BASE + reg) = val;
+    (void)lapic_read(LAPIC_ID);     /* Wait for the write to land */
+}
+
+int lapic_present(void) {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    return (d >> 9) & 1;
+}
+
+void lapic_init(void) {
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+uint32_t lapic_id(void) {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+static void lapic_ipi(uint32_t icr) {
+    lapic_write(LAPIC_ICR_HI, 0);
+    lapic_write(LAPIC_ICR_LO, icr);
+    while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING)
+        __asm__ volatile ("pause");
+}
+
+/* Sleep on the PIT tick; at least (n - 1) full tick periods */
+static void wait_ticks(uint32_t n) {
+    uint32_t start = timer_ticks;
+    while (timer_ticks - start < n)
+        __asm__ volatile ("hlt");
+}
+
+void lapic_start_aps(uint32_t entry) {
+    /* INIT, then >= 10 ms, then two start-ups (the second is ignored by
+     * CPUs that already woke on the first) */
+    lapic_ipi(ICR_INIT_ALL);
+    wait_ticks(2);
+    lapic_ipi(ICR_SIPI_ALL | (entry >> 12));
+    wait_ticks(1);
+    lapic_ipi(ICR_SIPI_ALL | (entry >> 12));
+}
+
+void lapic_timer_calibrate(void) {
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+
+    wait_ticks(1);                          /* Start on a tick edge */
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    wait_ticks(CALIBRATE_TICKS);
+    lapic_timer_count = (0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR)) / CALIBRATE_TICKS;
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+static void lapic_timer_handler(int_frame_t* frame) {
+    (void)frame;
+    sched_tick();
+}
+
+void lapic_timer_start(void) {
+    isr_register(LAPIC_TIMER_VECTOR, lapic_timer_handler);
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, lapic_timer_count);
+}
@@ -0,0 +1,26 @@
+/* lapic.h - Local APIC: CPU identification, IPIs and per-CPU timer */
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include "types.h"
+
+#define LAPIC_BASE      0xFEE00000  /* Default MMIO address (no paging) */
+
+/* 1 if CPUID reports an on-chip local APIC */
+int lapic_present(void);
+
+/* Software-enable this CPU's local APIC */
+void lapic_init(void);
+uint32_t lapic_id(void);
+void lapic_eoi(void);
+
+/* INIT-SIPI-SIPI to every other CPU; they start in real mode at
+ * physical address 'entry' (page aligned, below 1 MB) */
+void lapic_start_aps(uint32_t entry);
+
+/* Measure the APIC timer against the PIT tick (BSP, interrupts on),
+ * then run it periodically at the same rate on the calling CPU */
+void lapic_timer_calibrate(void);
+void lapic_timer_start(void);
+
+#endif
@@ -1,19 +1,309 @@
 #include "memory.h"
 #include "serial.h"
+#include "cpu.h"
+#include "pmm.h"
+#include "string.h"
+#include "spinlock.h"
 
 uint8_t stack[STACK_SIZE];
 uint8_t heap[HEAP_SIZE];
 
 static size_t stack_top = 0;
 
-// heap block 
-static MemBlock* heap_head = NULL;
+// process stack pool: free stacks are chained through their first word
+static uint8_t stack_pool[STACK_POOL_COUNT][STACK_PER_PROC] __attribute__((aligned(16)));
+static void* stack_pool_head = NULL;
+
+// heap growth regions taken from the page-frame allocator
+typedef struct HeapRegion {
+    size_t pages;
+    struct HeapRegion* next;
+} HeapRegion;
+
+// One seg-fit heap: size-class bins with a bitmap of the non-empty ones,
+// and the page regions it has grown into. The kernel heap is one of
+// these; the engine benchmark runs its own over a private region.
+typedef struct SegfitHeap {
+    MemBlock* bins[HEAP_NBINS];
+    uint32_t bin_map;           // bit i set = bins[i] non-empty
+    uint32_t free_blocks;       // free-list totals, kept up to date
+    size_t free_bytes;
+    HeapRegion* regions;
+    int can_grow;               // may take more pages from the pmm
+    HeapUsage* usage;           // live/footprint counters to charge
+} SegfitHeap;
+
+// buddy engine: power-of-two blocks inside one aligned arena
+// tag[i] describes the min-size block i: 0 = not a block head,
+// otherwise its order, with BUDDY_FREE set while it is on a free list.
+#define BUDDY_FREE 0x80
+#define BUDDY_BLOCKS (1 << (BUDDY_MAX_ORDER - BUDDY_MIN_ORDER))
+#define BUDDY_ARENA  (1 << BUDDY_MAX_ORDER)
+
+typedef struct BuddyBlock {
+    struct BuddyBlock* next;
+    struct BuddyBlock* prev;
+} BuddyBlock;
+
+typedef struct BuddyHeap {
+    uint8_t* base;              // BUDDY_ARENA bytes, aligned to its size
+    uint8_t tag[BUDDY_BLOCKS];
+    BuddyBlock* lists[BUDDY_MAX_ORDER + 1];
+    uint32_t map;               // bit k set = free list of order k non-empty
+    uint32_t free_blocks;
+    size_t free_bytes;
+    HeapUsage* usage;
+} BuddyHeap;
+
+static HeapUsage heap_usage;
+
+// instrumentation counters
+static uint32_t heap_alloc_calls = 0;
+static uint32_t heap_free_calls = 0;
+static uint32_t heap_failed_allocs = 0;
+static uint32_t heap_realloc_calls = 0;
+static uint32_t heap_realloc_in_place = 0;
+static uint32_t heap_size_hist[HEAP_HIST_BUCKETS];
+static spinlock_t heap_lock = SPINLOCK_INIT;  // heap_alloc/heap_free/heap_realloc
+static spinlock_t stack_pool_lock = SPINLOCK_INIT;  // stack_pool_alloc/stack_pool_free
+
+// engine serving heap_alloc
+static int heap_engine = HEAP_ENGINE;
+
+// the kernel heap: both engines, charged to the same usage counters
+static uint8_t buddy_heap[BUDDY_ARENA] __attribute__((aligned(BUDDY_ARENA)));
+static SegfitHeap kheap;
+static BuddyHeap kbuddy;
+
+// bin index = floor(log2(size))
+static int bin_index(size_t size) {
+    return bsr(size);
+}
+
+// push a free block onto the front of its bin
+static void bin_insert(SegfitHeap* h, MemBlock* block) {
+    int idx = bin_index(block->size);
+
+    block->prev_free = NULL;
+    block->next_free = h->bins[idx];
+    if (h->bins[idx])
+        h->bins[idx]->prev_free = block;
+    h->bins[idx] = block;
+    h->bin_map |= (1u << idx);
+    h->free_blocks++;
+    h->free_bytes += block->size;
+}
+
+// unlink a free block from its bin
+static void bin_remove(SegfitHeap* h, MemBlock* block) {
+    int idx = bin_index(block->size);
+
+    if (block->prev_free)
+        block->prev_free->next_free = block->next_free;
+    else
+        h->bins[idx] = block->next_free;
+    if (block->next_free)
+        block->next_free->prev_free = block->prev_free;
+
+    if (!h->bins[idx])
+        h->bin_map &= ~(1u << idx);
+    h->free_blocks--;
+    h->free_bytes -= block->size;
+
+    block->next_free = NULL;
+    block->prev_free = NULL;
+}
+
+// merge a free block with its free physical successor
+static void merge_next(SegfitHeap* h, MemBlock* block) {
+    MemBlock* next = block->next;
+
+    bin_remove(h, block);
+    bin_remove(h, next);
+    block->size += sizeof(MemBlock) + next->size;
+    block->next = next->next;
+    if (block->next)
+        block->next->prev = block;
+    bin_insert(h, block);
+}
+
+// seg-fit heap over one fixed region
+static void segfit_init(SegfitHeap* h, void* region, size_t size, HeapUsage* usage) {
+    for (int i = 0; i < HEAP_NBINS; i++)
+        h->bins[i] = NULL;
+    h->bin_map = 0;
+    h->free_blocks = 0;
+    h->free_bytes = 0;
+    h->regions = NULL;
+    h->can_grow = 0;
+    h->usage = usage;
+
+    MemBlock* head = (MemBlock*)region;
+    head->size = size - sizeof(MemBlock);
+    head->free = 1;
+    head->next = NULL;
+    head->prev = NULL;
+    bin_insert(h, head);
+}
+
+// buddy block index (in min-size units) of a pointer
+static int buddy_index(BuddyHeap* h, void* ptr) {
+    return ((uint8_t*)ptr - h->base) >> BUDDY_MIN_ORDER;
+}
+
+static void buddy_push(BuddyHeap* h, int idx, int order) {
+    BuddyBlock* block = (BuddyBlock*)(h->base + (idx << BUDDY_MIN_ORDER));
+
+    block->prev = NULL;
+    block->next = h->lists[order];
+    if (block->next)
+        block->next->prev = block;
+    h->lists[order] = block;
+    h->map |= (1u << order);
+    h->tag[idx] = BUDDY_FREE | order;
+    h->free_blocks++;
+    h->free_bytes += 1u << order;
+}
+
+static void buddy_unlink(BuddyHeap* h, int idx, int order) {
+    BuddyBlock* block = (BuddyBlock*)(h->base + (idx << BUDDY_MIN_ORDER));
+
+    if (block->prev)
+        block->prev->next = block->next;
+    else
+        h->lists[order] = block->next;
+    if (block->next)
+        block->next->prev = block->prev;
+    if (!h->lists[order])
+        h->map &= ~(1u << order);
+    h->tag[idx] = 0;
+    h->free_blocks--;
+    h->free_bytes -= 1u << order;
+}
+
+// buddy heap over one BUDDY_ARENA-aligned arena
+static void buddy_init(BuddyHeap* h, uint8_t* base, HeapUsage* usage) {
+    h->base = base;
+    h->usage = usage;
+    for (int i = 0; i < BUDDY_BLOCKS; i++)
+        h->tag[i] = 0;
+    for (int k = 0; k <= BUDDY_MAX_ORDER; k++)
+        h->lists[k] = NULL;
+    h->map = 0;
+    h->free_blocks = 0;
+    h->free_bytes = 0;
+    buddy_push(h, 0, BUDDY_MAX_ORDER);
+}
+
+// smallest free block of a large enough order, split down: O(log n)
+static void* buddy_alloc(BuddyHeap* h, size_t size) {
+    int order = BUDDY_MIN_ORDER;
+
+    if (size > (1u << BUDDY_MAX_ORDER))
+        return NULL;
+    if (size > (1u << BUDDY_MIN_ORDER))
+        order = bsr(size - 1) + 1;
+
+    uint32_t mask = h->map & ~((1u << order) - 1);
+    if (!mask)
+        return NULL;
+
+    int k = bsf(mask);
+    int idx = buddy_index(h, h->lists[k]);
+    buddy_unlink(h, idx, k);
+
+    // hand the upper half back at each level until the order fits
+    while (k > order) {
+        k--;
+        buddy_push(h, idx + (1 << (k - BUDDY_MIN_ORDER)), k);
+    }
+
+    h->tag[idx] = order;
+    h->usage->live += 1u << order;
+    if (h->usage->live > h->usage->peak_live)
+        h->usage->peak_live = h->usage->live;
+    return h->base + (idx << BUDDY_MIN_ORDER);
+}
+
+// merge with the buddy while it is free and of the same order: O(log n)
+static void buddy_free(BuddyHeap* h, void* ptr) {
+    int idx = buddy_index(h, ptr);
+    int order = h->tag[idx];
+
+    h->usage->live -= 1u << order;
+
+    while (order < BUDDY_MAX_ORDER) {
+        int buddy = idx ^ (1 << (order - BUDDY_MIN_ORDER));
+        if (h->tag[buddy] != (BUDDY_FREE | order))
+            break;
+        buddy_unlink(h, buddy, order);
+        h->tag[idx] = 0;
+        if (buddy < idx)
+            idx = buddy;
+        order++;
+    }
+
+    buddy_push(h, idx, order);
+}
+
+// resize a buddy block in place; 0 if it has to move
+// Shrinking hands the upper halves back; growing absorbs the buddies
+// above the block, which works while the block is the lower half at
+// each order on the way up and all those buddies are free.
+static int buddy_resize(BuddyHeap* h, void* ptr, size_t size) {
+    int idx = buddy_index(h, ptr);
+    int old = h->tag[idx];
+    int order = BUDDY_MIN_ORDER;
+
+    if (size > (1u << BUDDY_MAX_ORDER))
+        return 0;
+    if (size > (1u << BUDDY_MIN_ORDER))
+        order = bsr(size - 1) + 1;
+
+    if (order > old) {
+        if (idx & ((1 << (order - BUDDY_MIN_ORDER)) - 1))
+            return 0;
+        for (int k = old; k < order; k++)
+            if (h->tag[idx + (1 << (k - BUDDY_MIN_ORDER))] != (BUDDY_FREE | k))
+                return 0;
+        for (int k = old; k < order; k++)
+            buddy_unlink(h, idx + (1 << (k - BUDDY_MIN_ORDER)), k);
+    }
+    else {
+        for (int k = old - 1; k >= order; k--)
+            buddy_push(h, idx + (1 << (k - BUDDY_MIN_ORDER)), k);
+    }
+
+    h->tag[idx] = order;
+    h->usage->live += 1u << order;
+    h->usage->live -= 1u << old;
+    if (h->usage->live > h->usage->peak_live)
+        h->usage->peak_live = h->usage->live;
+    return 1;
+}
+
+static int in_buddy_heap(BuddyHeap* h, void* ptr) {
+    return (uint8_t*)ptr >= h->base && (uint8_t*)ptr < h->base + BUDDY_ARENA;
+}
 
 void memory_init(void) {
-    heap_head = (MemBlock*)heap;
-    heap_head->size = HEAP_SIZE - sizeof(MemBlock);
-    heap_head->free = 1;
-    heap_head->next = NULL;
+    heap_alloc_calls = heap_free_calls = heap_failed_allocs = 0;
+    heap_realloc_calls = heap_realloc_in_place = 0;
+    for (int i = 0; i < HEAP_HIST_BUCKETS; i++)
+        heap_size_hist[i] = 0;
+
+    heap_usage.footprint = heap_usage.peak_footprint = HEAP_SIZE;
+    heap_usage.live = heap_usage.peak_live = 0;
+
+    segfit_init(&kheap, heap, HEAP_SIZE, &heap_usage);
+    kheap.can_grow = 1;
+    buddy_init(&kbuddy, buddy_heap, &heap_usage);
+
+    stack_pool_head = NULL;
+    for (int i = STACK_POOL_COUNT - 1; i >= 0; i--) {
+        *(void**)stack_pool[i] = stack_pool_head;
+        stack_pool_head = stack_pool[i];
+    }
 }
 
 // stack allocation (no free, just bump pointer)
@@ -35,77 +325,636 @@ void stack_free(size_t size) {
     }
 }
 
-// best fit heap
-void* heap_alloc(size_t size) {
-    // Alignment
-    size = (size + 3) & ~3;
+// find a free block of at least size bytes
+static MemBlock* find_fit(SegfitHeap* h, size_t size) {
+    int idx = bin_index(size);
+    uint32_t mask;
 
-    MemBlock* curr = heap_head;
-    MemBlock* best_block = NULL;
+    // Every block in a bin above the request's own class is big enough,
+    // so the lowest non-empty one is taken straight off the bitmap - O(1).
+    // Power-of-two requests (e.g. 1 KB stacks) are safe in their own bin.
+    if ((size & (size - 1)) == 0)
+        mask = h->bin_map & ~((1u << idx) - 1);
+    else
+        mask = (idx + 1 < HEAP_NBINS) ? h->bin_map & ~((2u << idx) - 1) : 0;
 
-    //Best-Fit Search
-    while (curr) {
-        if (curr->free && curr->size >= size) {
-            if (best_block == NULL || curr->size < best_block->size) {
+    if (mask)
+        return h->bins[bsf(mask)];
+
+    // Fall back to a best-fit scan of the request's own bin
+    MemBlock* best_block = NULL;
+    for (MemBlock* curr = h->bins[idx]; curr; curr = curr->next_free) {
+        if (curr->size >= size) {
+            if (best_block == NULL || curr->size < best_block->size)
                 best_block = curr;
-            }
             if (curr->size == size) break;
         }
-        curr = curr->next;
     }
+    return best_block;
+}
+
+// take a new region of at least HEAP_GROW_PAGES pages big enough for size
+static int heap_grow(SegfitHeap* h, size_t size) {
+    size_t bytes, pages;
+
+    // keeps the header and page round-up below from wrapping
+    if (size > HEAP_MAX_REQUEST)
+        return 0;
+
+    bytes = sizeof(HeapRegion) + sizeof(MemBlock) + size;
+    pages = (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    if (pages < HEAP_GROW_PAGES)
+        pages = HEAP_GROW_PAGES;
+
+    HeapRegion* region = (HeapRegion*)pmm_alloc_frames(pages);
+    if (!region)
+        return 0;
+
+    region->pages = pages;
+    region->next = h->regions;
+    h->regions = region;
+
+    // one free block spanning the region; its chain never links to others
+    MemBlock* block = (MemBlock*)(region + 1);
+    block->size = pages * PAGE_SIZE - sizeof(HeapRegion) - sizeof(MemBlock);
+    block->free = 1;
+    block->next = NULL;
+    block->prev = NULL;
+    bin_insert(h, block);
+
+    h->usage->footprint += pages * PAGE_SIZE;
+    if (h->usage->footprint > h->usage->peak_footprint)
+        h->usage->peak_footprint = h->usage->footprint;
+    return 1;
+}
+
+// give whole free pages at the tail of a grown region back to the pmm
+static void heap_trim(SegfitHeap* h, MemBlock* block) {
+    uint8_t* start = (uint8_t*)block;
+    uint8_t* end = start + sizeof(MemBlock) + block->size;
+    HeapRegion** link = &h->regions;
+
+    while (*link && (uint8_t*)*link + (*link)->pages * PAGE_SIZE != end)
+        link = &(*link)->next;
+
+    HeapRegion* region = *link;
+    if (!region)
+        return;  // static heap - never released
+
+    // whole region is free: drop it
+    if (!block->prev) {
+        bin_remove(h, block);
+        *link = region->next;
+        h->usage->footprint -= region->pages * PAGE_SIZE;
+        pmm_free_frames(region, region->pages);
+        return;
+    }
+
+    // cut at the first page boundary that leaves a usable block (or none)
+    uint8_t* cut = (uint8_t*)(((uint32_t)start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+    if (cut != start && (size_t)(cut - start) < sizeof(MemBlock) + 4)
+        cut += PAGE_SIZE;
+    if (cut >= end)
+        return;
+
+    size_t pages = (end - cut) / PAGE_SIZE;
+
+    bin_remove(h, block);
+    if (cut == start) {
+        block->prev->next = NULL;
+    }
+    else {
+        block->size = cut - start - sizeof(MemBlock);
+        bin_insert(h, block);
+    }
+
+    region->pages -= pages;
+    h->usage->footprint -= pages * PAGE_SIZE;
+    pmm_free_frames(cut, pages);
+}
+
+// Splitting Logic Only split if we can fit a new header AND at least 4 bytes of data
+// (the remainder goes back on a free list)
+static MemBlock* split_block(SegfitHeap* h, MemBlock* block, size_t size) {
+    size_t min_split_size = sizeof(MemBlock) + 4;
+
+    if (block->size < size + min_split_size)
+        return NULL;
+
+    MemBlock* next = (MemBlock*)((uint8_t*)block + sizeof(MemBlock) + size);
+    next->size = block->size - size - sizeof(MemBlock);
+    next->free = 1;
+    next->next = block->next;
+    next->prev = block;
+    if (next->next)
+        next->next->prev = next;
+
+    block->size = size;
+    block->next = next;
+    bin_insert(h, next);
+    return next;
+}
+
+// segregated-fit heap (heap_alloc has already rounded 0 up)
+static void* segfit_alloc(SegfitHeap* h, size_t size) {
+    if (size > HEAP_MAX_REQUEST)
+        return NULL;
+
+    // Alignment
+    size = (size + 3) & ~3;
+
+    MemBlock* best_block = find_fit(h, size);
+
+    // Out of room: grow the heap with more pages and retry
+    if (!best_block && h->can_grow && heap_grow(h, size))
+        best_block = find_fit(h, size);
 
     if (best_block) {
-        // Splitting Logic Only split if we can fit a new header AND at least 4 bytes of data
-    
-        size_t min_split_size = sizeof(MemBlock) + 4;
-
-        if (best_block->size >= size + min_split_size) {
-            MemBlock* next = (MemBlock*)((uint8_t*)best_block + sizeof(MemBlock) + size);
-            next->size = best_block->size - size - sizeof(MemBlock);
-            next->free = 1;
-            next->next = best_block->next;
-
-            best_block->size = size;
-            best_block->next = next;
-        }
+        bin_remove(h, best_block);
+
+        split_block(h, best_block, size);
 
         best_block->free = 0;
-        // Return pointer to data 
+        h->usage->live += best_block->size;
+        if (h->usage->live > h->usage->peak_live)
+            h->usage->peak_live = h->usage->live;
+        // Return pointer to data
         return (void*)((uint8_t*)best_block + sizeof(MemBlock));
     }
 
     return NULL;
 }
 
-// free heap block
-void heap_free(void* ptr) {
-    if (!ptr) return;
-
+// free segregated-fit block
+static void segfit_free(SegfitHeap* h, void* ptr) {
     // Locate the header
     MemBlock* block = (MemBlock*)((uint8_t*)ptr - sizeof(MemBlock));
     block->free = 1;
+    h->usage->live -= block->size;
+    bin_insert(h, block);
 
-    //Forward Merge
+    // Both neighbours are one pointer away, so coalescing never walks the list
     if (block->next && block->next->free) {
-        block->size += sizeof(MemBlock) + block->next->size;
-        block->next = block->next->next;
+        merge_next(h, block);
+    }
+    if (block->prev && block->prev->free) {
+        block = block->prev;
+        merge_next(h, block);
+    }
+
+    // Free space at the end of a grown region goes back to the pmm
+    if (!block->next && h->regions)
+        heap_trim(h, block);
+}
+
+// resize a seg-fit block in place; 0 if it has to move
+static int segfit_resize(SegfitHeap* h, void* ptr, size_t size) {
+    MemBlock* block = (MemBlock*)((uint8_t*)ptr - sizeof(MemBlock));
+    size_t old_size = block->size;
+
+    if (size > HEAP_MAX_REQUEST)
+        return 0;
+    size = (size + 3) & ~3;
+
+    // grow: absorb the free successor when old + header + next covers it
+    if (size > block->size) {
+        MemBlock* next = block->next;
+        if (!next || !next->free || block->size + sizeof(MemBlock) + next->size < size)
+            return 0;
+
+        bin_remove(h, next);
+        block->size += sizeof(MemBlock) + next->size;
+        block->next = next->next;
+        if (block->next)
+            block->next->prev = block;
     }
 
-    //Global Coalesce 
-    MemBlock* curr = heap_head;
-    while (curr && curr->next) {
-        if (curr->free && curr->next->free) {
-            curr->size += sizeof(MemBlock) + curr->next->size;
-            curr->next = curr->next->next;
+    // shrink (or trim what growth absorbed); the tail rejoins free space
+    MemBlock* rest = split_block(h, block, size);
+    if (rest && rest->next && rest->next->free)
+        merge_next(h, rest);
+    if (rest && !rest->next && h->regions)
+        heap_trim(h, rest);
+
+    h->usage->live += block->size;
+    h->usage->live -= old_size;
+    if (h->usage->live > h->usage->peak_live)
+        h->usage->peak_live = h->usage->live;
+    return 1;
+}
+
+// choose the engine that serves heap_alloc
+int heap_set_engine(int engine) {
+    if (engine != HEAP_ENGINE_SEGFIT && engine != HEAP_ENGINE_BUDDY)
+        return -1;
+    heap_engine = engine;
+    return 0;
+}
+
+int heap_get_engine(void) {
+    return heap_engine;
+}
+
+// allocate from the selected engine; the buddy arena is fixed-size, so
+// once it is exhausted requests spill over to the growable seg-fit heap
+void* heap_alloc(size_t size) {
+    void* ptr = NULL;
+    uint32_t mask = spin_lock_irqsave(&heap_lock);
+
+    heap_alloc_calls++;
+    if (size == 0)
+        size = 4;  // a zero-byte request still gets the smallest block
+
+    int bucket = (size <= 8) ? 0 : bsr(size - 1) - 2;
+    if (bucket >= HEAP_HIST_BUCKETS)
+        bucket = HEAP_HIST_BUCKETS - 1;
+    heap_size_hist[bucket]++;
+
+    if (heap_engine == HEAP_ENGINE_BUDDY)
+        ptr = buddy_alloc(&kbuddy, size);
+    if (!ptr)
+        ptr = segfit_alloc(&kheap, size);
+    if (!ptr)
+        heap_failed_allocs++;
+    spin_unlock_irqrestore(&heap_lock, mask);
+    return ptr;
+}
+
+// free heap block; the owning engine is known from the address
+void heap_free(void* ptr) {
+    if (!ptr) return;
+
+    uint32_t mask = spin_lock_irqsave(&heap_lock);
+    heap_free_calls++;
+
+    if (in_buddy_heap(&kbuddy, ptr))
+        buddy_free(&kbuddy, ptr);
+    else
+        segfit_free(&kheap, ptr);
+    spin_unlock_irqrestore(&heap_lock, mask);
+}
+
+// resize an allocation, in place when the block (or its free neighbour)
+// allows it, otherwise by moving the data to a new block
+void* heap_realloc(void* ptr, size_t size) {
+    size_t old_size;
+    uint32_t mask;
+
+    if (!ptr)
+        return heap_alloc(size);
+    if (size == 0) {
+        heap_free(ptr);
+        return NULL;
+    }
+    if (size > HEAP_MAX_REQUEST)
+        return NULL;  // as for a failed move, the block is left untouched
+
+    mask = spin_lock_irqsave(&heap_lock);
+    heap_realloc_calls++;
+
+    if (in_buddy_heap(&kbuddy, ptr)) {
+        old_size = 1u << kbuddy.tag[buddy_index(&kbuddy, ptr)];
+        if (buddy_resize(&kbuddy, ptr, size)) {
+            heap_realloc_in_place++;
+            spin_unlock_irqrestore(&heap_lock, mask);
+            return ptr;
+        }
+    }
+    else {
+        old_size = ((MemBlock*)((uint8_t*)ptr - sizeof(MemBlock)))->size;
+        if (segfit_resize(&kheap, ptr, size)) {
+            heap_realloc_in_place++;
+            spin_unlock_irqrestore(&heap_lock, mask);
+            return ptr;
+        }
+    }
+
+    spin_unlock_irqrestore(&heap_lock, mask);
+
+    // the caller owns the block, so moving it needs no lock of its own
+    void* new_ptr = heap_alloc(size);
+    if (!new_ptr)
+        return NULL;  // original block is left untouched
+
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    heap_free(ptr);
+    return new_ptr;
+}
+
+// snapshot of heap footprint and live bytes
+void heap_get_usage(HeapUsage* usage) {
+    *usage = heap_usage;
+}
+
+// an idle buddy arena would only distort the free-space figures
+static int buddy_in_use(void) {
+    return heap_engine == HEAP_ENGINE_BUDDY || kbuddy.free_bytes != BUDDY_ARENA;
+}
+
+// largest free block: only the top non-empty bin/order needs looking at
+static size_t largest_free_block(void) {
+    size_t largest = 0;
+
+    if (kheap.bin_map) {
+        for (MemBlock* b = kheap.bins[bsr(kheap.bin_map)]; b; b = b->next_free)
+            if (b->size > largest)
+                largest = b->size;
+    }
+    if (buddy_in_use() && kbuddy.map && (1u << bsr(kbuddy.map)) > largest)
+        largest = 1u << bsr(kbuddy.map);
+    return largest;
+}
+
+void heap_get_stats(HeapStats* stats) {
+    stats->alloc_calls = heap_alloc_calls;
+    stats->free_calls = heap_free_calls;
+    stats->failed_allocs = heap_failed_allocs;
+    stats->realloc_calls = heap_realloc_calls;
+    stats->realloc_in_place = heap_realloc_in_place;
+    stats->usage = heap_usage;
+    stats->free_blocks = kheap.free_blocks;
+    stats->free_bytes = kheap.free_bytes;
+    if (buddy_in_use()) {
+        stats->free_blocks += kbuddy.free_blocks;
+        stats->free_bytes += kbuddy.free_bytes;
+    }
+    stats->largest_free = largest_free_block();
+    stats->frag_pct = stats->free_bytes ?
+        100 - (stats->largest_free * 100) / stats->free_bytes : 0;
+    for (int i = 0; i < HEAP_HIST_BUCKETS; i++)
+        stats->size_hist[i] = heap_size_hist[i];
+}
+
+static void print_stat(const char* label, uint32_t value) {
+    serial_puts(label);
+    serial_putdec(value);
+    serial_puts("\n");
+}
+
+void heap_print_stats(void) {
+    HeapStats st;
+
+    heap_get_stats(&st);
+
+    serial_puts("Heap engine: ");
+    serial_puts(heap_engine == HEAP_ENGINE_BUDDY ? "buddy\n" : "seg-fit\n");
+    print_stat("  alloc calls:    ", st.alloc_calls);
+    print_stat("  free calls:     ", st.free_calls);
+    print_stat("  failed allocs:  ", st.failed_allocs);
+    print_stat("  realloc calls:  ", st.realloc_calls);
+    print_stat("  ...in place:    ", st.realloc_in_place);
+    print_stat("  bytes live:     ", st.usage.live);
+    print_stat("  peak live:      ", st.usage.peak_live);
+    print_stat("  footprint:      ", st.usage.footprint);
+    print_stat("  peak footprint: ", st.usage.peak_footprint);
+    print_stat("  free blocks:    ", st.free_blocks);
+    print_stat("  free bytes:     ", st.free_bytes);
+    print_stat("  largest free:   ", st.largest_free);
+    print_stat("  fragmentation%: ", st.frag_pct);
+
+    serial_puts("  request sizes:\n");
+    for (int i = 0; i < HEAP_HIST_BUCKETS; i++) {
+        serial_puts("    ");
+        if (i == HEAP_HIST_BUCKETS - 1) {
+            serial_puts(">");
+            serial_putdec(4u << i);
         }
         else {
-            // no need for checking
-            if (curr > block) break;
-            curr = curr->next;
+            serial_puts("<=");
+            serial_putdec(8u << i);
         }
+        serial_puts(": ");
+        serial_putdec(st.size_hist[i]);
+        serial_puts("\n");
     }
 }
 
+// take a process stack from the pool, NULL if it is exhausted
+void* stack_pool_alloc(void) {
+    uint32_t mask = spin_lock_irqsave(&stack_pool_lock);
+    void* stk = stack_pool_head;
+
+    if (stk)
+        stack_pool_head = *(void**)stk;
+    spin_unlock_irqrestore(&stack_pool_lock, mask);
+    return stk;
+}
+
+// return a stack to the pool; 0 if it was not a pool stack
+// The free list is LIFO, so the next spawn reuses the most recently
+// freed (still cache-warm) stack.
+int stack_pool_free(void* stk) {
+    uint8_t* p = (uint8_t*)stk;
+    uint32_t mask;
+
+    if (p < (uint8_t*)stack_pool || p >= (uint8_t*)stack_pool + sizeof(stack_pool))
+        return 0;
+
+    mask = spin_lock_irqsave(&stack_pool_lock);
+    *(void**)stk = stack_pool_head;
+    stack_pool_head = stk;
+    spin_unlock_irqrestore(&stack_pool_lock, mask);
+    return 1;
+}
+
+// churn benchmark: interleaved alloc/free of mixed sizes
+#define CHURN_SLOTS  8
+#define CHURN_ROUNDS 2000
+
+static void heap_churn_benchmark(void) {
+    static const size_t sizes[CHURN_SLOTS] = { 16, 512, 40, 128, 512, 24, 200, 64 };
+    void* live[CHURN_SLOTS] = { 0 };
+    uint32_t alloc_cycles = 0, free_cycles = 0;
+    uint32_t allocs = 0, frees = 0, failed = 0;
+
+    serial_puts("Heap churn benchmark...\n");
+
+    for (int i = 0; i < CHURN_ROUNDS; i++) {
+        int slot = (i * 5) % CHURN_SLOTS;
+        uint32_t t0, t1;
+
+        if (live[slot]) {
+            t0 = rdtsc();
+            heap_free(live[slot]);
+            t1 = rdtsc();
+            live[slot] = NULL;
+            free_cycles += t1 - t0;
+            frees++;
+        }
+        else {
+            t0 = rdtsc();
+            live[slot] = heap_alloc(sizes[(i / CHURN_SLOTS + slot) % CHURN_SLOTS]);
+            t1 = rdtsc();
+            alloc_cycles += t1 - t0;
+            allocs++;
+            if (!live[slot]) failed++;
+        }
+    }
+
+    for (int i = 0; i < CHURN_SLOTS; i++)
+        heap_free(live[i]);
+
+    serial_puts("  allocs: ");
+    serial_putdec(allocs);
+    serial_puts(", cycles/alloc: ");
+    serial_putdec(allocs ? alloc_cycles / allocs : 0);
+    serial_puts("\n  frees: ");
+    serial_putdec(frees);
+    serial_puts(", cycles/free: ");
+    serial_putdec(frees ? free_cycles / frees : 0);
+    serial_puts("\n  failed allocs: ");
+    serial_putdec(failed);
+    serial_puts("\n");
+}
+
+// free-space totals for the fragmentation report
+static void segfit_free_space(SegfitHeap* h, size_t* total, size_t* largest) {
+    *total = *largest = 0;
+    for (int i = 0; i < HEAP_NBINS; i++) {
+        for (MemBlock* b = h->bins[i]; b; b = b->next_free) {
+            *total += b->size;
+            if (b->size > *largest)
+                *largest = b->size;
+        }
+    }
+}
+
+static void buddy_free_space(BuddyHeap* h, size_t* total, size_t* largest) {
+    *total = *largest = 0;
+    for (int k = BUDDY_MIN_ORDER; k <= BUDDY_MAX_ORDER; k++) {
+        for (BuddyBlock* b = h->lists[k]; b; b = b->next) {
+            *total += 1u << k;
+            *largest = 1u << k;
+        }
+    }
+}
+
+// engine comparison: the same seeded alloc/free trace against each engine
+#define TRACE_SLOTS 32
+#define TRACE_OPS   4000
+#define TRACE_SEED  12345
+
+// Each engine replays the trace over this private region, set up afresh
+// for every run, so both start empty and neither touches the kernel heap
+static uint8_t bench_region[BUDDY_ARENA] __attribute__((aligned(BUDDY_ARENA)));
+static SegfitHeap bench_segfit;
+static BuddyHeap bench_buddy;
+static HeapUsage bench_usage;
+
+static void bench_segfit_reset(void) {
+    segfit_init(&bench_segfit, bench_region, sizeof(bench_region), &bench_usage);
+}
+static void* bench_segfit_alloc(size_t size) {
+    return segfit_alloc(&bench_segfit, size);
+}
+static void bench_segfit_free(void* ptr) {
+    segfit_free(&bench_segfit, ptr);
+}
+static void bench_segfit_space(size_t* total, size_t* largest) {
+    segfit_free_space(&bench_segfit, total, largest);
+}
+
+static void bench_buddy_reset(void) {
+    buddy_init(&bench_buddy, bench_region, &bench_usage);
+}
+static void* bench_buddy_alloc(size_t size) {
+    return buddy_alloc(&bench_buddy, size);
+}
+static void bench_buddy_free(void* ptr) {
+    buddy_free(&bench_buddy, ptr);
+}
+static void bench_buddy_space(size_t* total, size_t* largest) {
+    buddy_free_space(&bench_buddy, total, largest);
+}
+
+typedef struct HeapEngineOps {
+    const char* name;
+    void (*reset)(void);
+    void* (*alloc)(size_t size);
+    void (*free)(void* ptr);
+    void (*free_space)(size_t* total, size_t* largest);
+} HeapEngineOps;
+
+static uint32_t trace_rand(uint32_t* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 16;
+}
+
+// The region is private, so no heap_lock is needed; interrupts are off
+// only for each timed operation, so a tick can't land inside one
+static void run_engine_trace(const HeapEngineOps* eng) {
+    void* live[TRACE_SLOTS] = { 0 };
+    uint32_t seed = TRACE_SEED;
+    uint32_t cycles = 0, ops = 0, failed = 0;
+    size_t total, largest;
+
+    bench_usage.live = bench_usage.peak_live = 0;
+    bench_usage.footprint = bench_usage.peak_footprint = sizeof(bench_region);
+    eng->reset();
+
+    for (int i = 0; i < TRACE_OPS; i++) {
+        uint32_t r = trace_rand(&seed);
+        int slot = r % TRACE_SLOTS;
+        uint32_t t0, flags;
+
+        if (live[slot]) {
+            flags = irq_disable();
+            t0 = rdtsc();
+            eng->free(live[slot]);
+            cycles += rdtsc() - t0;
+            irq_restore(flags);
+            live[slot] = NULL;
+        }
+        else {
+            // mostly small objects with an occasional stack-sized one
+            size_t size = ((r >> 5) % 8 == 0) ? 256 + (r >> 8) % 512 : 8 + (r >> 8) % 128;
+            flags = irq_disable();
+            t0 = rdtsc();
+            live[slot] = eng->alloc(size);
+            cycles += rdtsc() - t0;
+            irq_restore(flags);
+            if (!live[slot]) failed++;
+        }
+        ops++;
+    }
+
+    // measure the region as the churn left it; the next reset discards it
+    eng->free_space(&total, &largest);
+
+    serial_puts("  ");
+    serial_puts(eng->name);
+    serial_puts(": cycles/op ");
+    serial_putdec(cycles / ops);
+    serial_puts(", failed ");
+    serial_putdec(failed);
+    serial_puts(", free ");
+    serial_putdec(total);
+    serial_puts(" B, largest block ");
+    serial_putdec(largest);
+    serial_puts(" B, fragmentation ");
+    serial_putdec(total ? 100 - (largest * 100) / total : 0);
+    serial_puts("%\n");
+}
+
+static void heap_engine_benchmark(void) {
+    static const HeapEngineOps engines[] = {
+        { "seg-fit", bench_segfit_reset, bench_segfit_alloc, bench_segfit_free, bench_segfit_space },
+        { "buddy  ", bench_buddy_reset, bench_buddy_alloc, bench_buddy_free, bench_buddy_space },
+    };
+
+    serial_puts("Heap engine comparison (seed ");
+    serial_putdec(TRACE_SEED);
+    serial_puts(", ");
+    serial_putdec(TRACE_OPS);
+    serial_puts(" ops, ");
+    serial_putdec(sizeof(bench_region) / 1024);
+    serial_puts(" KB each)...\n");
+
+    for (int i = 0; i < 2; i++)
+        run_engine_trace(&engines[i]);
+}
+
 // stress test
 void stress_test_memory(void) {
     serial_puts("\n--- Starting KacchiOS Memory Stress Test ---\n");
@@ -150,5 +999,77 @@ void stress_test_memory(void) {
         serial_puts("  FAILURE: Heap is still fragmented. Merge failed.\n");
     }
 
+    /* Realloc: in-place growth into a free neighbour, then a forced move */
+    serial_puts("Testing Heap Realloc...\n");
+    char* r = (char*)heap_alloc(32);
+    if (r) {
+        memset(r, 'k', 32);
+        char* r2 = (char*)heap_realloc(r, 200);
+        serial_puts(r2 == r ? "  SUCCESS: grew in place into free neighbour\n" :
+                              "  FAILURE: grow moved the block\n");
+        void* blocker = heap_alloc(16);
+        char* r3 = (char*)heap_realloc(r2, 2000);
+        int kept = r3 && r3[0] == 'k' && r3[31] == 'k';
+        serial_puts(kept ? "  SUCCESS: moved block kept its contents\n" :
+                           "  FAILURE: realloc lost data\n");
+        heap_free(blocker);
+        heap_free(r3 ? r3 : r2);
+    }
+
+    /* Sizes that would wrap when rounded up must fail, not succeed small */
+    serial_puts("Testing Oversized Requests...\n");
+    int refused = heap_alloc((size_t)-2) == NULL &&
+                  heap_alloc(HEAP_MAX_REQUEST + 1) == NULL;
+    char* keep = (char*)heap_alloc(64);
+    if (keep) {
+        HeapUsage before, after;
+        memset(keep, 'q', 64);
+        heap_get_usage(&before);
+        if (heap_realloc(keep, (size_t)-3) != NULL)
+            refused = 0;
+        heap_get_usage(&after);
+        if (after.live != before.live || keep[0] != 'q' || keep[63] != 'q')
+            refused = 0;
+        heap_free(keep);
+    }
+    serial_puts(refused ? "  SUCCESS: oversized allocations and reallocs refused\n" :
+                          "  FAILURE: oversized request succeeded\n");
+
+    /* A zero-byte request gets a real block, as it always has */
+    void* z = heap_alloc(0);
+    serial_puts(z ? "  SUCCESS: zero-byte allocation returned a block\n" :
+                    "  FAILURE: zero-byte allocation returned NULL\n");
+    heap_free(z);
+
+    /* Heap growth beyond HEAP_SIZE and release back to the page allocator */
+    serial_puts("Testing Heap Growth...\n");
+    void* g[3];
+    int grown = 1;
+    for (int i = 0; i < 3; i++) {
+        g[i] = heap_alloc(HEAP_SIZE / 2);
+        if (!g[i]) grown = 0;
+    }
+    HeapUsage usage;
+    heap_get_usage(&usage);
+    serial_puts(grown ? "  SUCCESS: allocated 1.5x HEAP_SIZE, footprint " :
+                        "  FAILURE: heap did not grow, footprint ");
+    serial_putdec(usage.footprint);
+    serial_puts(" bytes\n");
+    for (int i = 0; i < 3; i++)
+        heap_free(g[i]);
+    heap_get_usage(&usage);
+    serial_puts(usage.footprint == HEAP_SIZE ? "  SUCCESS: grown pages returned, footprint " :
+                                              "  FAILURE: pages not returned, footprint ");
+    serial_putdec(usage.footprint);
+    serial_puts(" bytes, peak ");
+    serial_putdec(usage.peak_footprint);
+    serial_puts(" bytes\n");
+
+    /* Allocation churn benchmark */
+    heap_churn_benchmark();
+
+    /* Seg-fit vs buddy on an identical trace */
+    heap_engine_benchmark();
+
     serial_puts("--- Stress Test Complete ---\n\n");
 }
\ No newline at end of file
@@ -6,6 +6,11 @@
 #define STACK_SIZE 4096
 #define HEAP_SIZE  8192
 
+#define HEAP_GROW_PAGES  4     // Minimum pages taken per heap growth
+
+#define STACK_PER_PROC   1024 // Process stack size (at least STACK_MIN)
+#define STACK_POOL_COUNT 8    // Pre-carved process stacks
+
 extern uint8_t stack[STACK_SIZE];
 extern uint8_t heap[HEAP_SIZE];
 
@@ -16,17 +21,79 @@ void stress_test_memory(void);
 void* stack_alloc(size_t size);
 void stack_free(size_t size);
 
+// Heap engines
+#define HEAP_ENGINE_SEGFIT 0    // segregated best-fit lists (growable)
+#define HEAP_ENGINE_BUDDY  1    // binary buddy over a fixed arena
+
+// Build-time default; override with make DEFS=-DHEAP_ENGINE=HEAP_ENGINE_BUDDY
+#ifndef HEAP_ENGINE
+#define HEAP_ENGINE HEAP_ENGINE_SEGFIT
+#endif
+
+// Buddy arena: 2^BUDDY_MAX_ORDER bytes, smallest block 2^BUDDY_MIN_ORDER
+#define BUDDY_MIN_ORDER 5
+#define BUDDY_MAX_ORDER 13
+
+// Largest heap request; bigger ones fail before any rounding or header
+// arithmetic could wrap around
+#define HEAP_MAX_REQUEST 0x40000000
+
 // Heap allocation
 void* heap_alloc(size_t size);
 void heap_free(void* ptr);
+void* heap_realloc(void* ptr, size_t size);
+int heap_set_engine(int engine);
+int heap_get_engine(void);
+
+// Process stack pool (fixed-size STACK_PER_PROC slabs)
+void* stack_pool_alloc(void);
+int stack_pool_free(void* stk);
 
 // Memory block structure for heap
 typedef struct MemBlock {
     size_t size;
     int free;
-    struct MemBlock* next;
+    struct MemBlock* next;       // physical successor in the heap
+    struct MemBlock* prev;       // physical predecessor (O(1) coalescing)
+    struct MemBlock* next_free;  // size-class bin links (only while free)
+    struct MemBlock* prev_free;
 } MemBlock;
 
+// Segregated free lists: bin i holds free blocks with size in [2^i, 2^(i+1))
+#define HEAP_NBINS 32
+
+// Heap memory usage (bytes)
+typedef struct HeapUsage {
+    size_t footprint;       // memory held by the heap (static + grown pages)
+    size_t peak_footprint;  // high-water mark of footprint
+    size_t live;            // bytes handed out and not yet freed
+    size_t peak_live;       // high-water mark of live
+} HeapUsage;
+
+void heap_get_usage(HeapUsage* usage);
+
+// Request-size histogram: bucket 0 is 1-8 bytes, bucket i covers
+// (2^(i+2), 2^(i+3)], the last bucket takes everything larger
+#define HEAP_HIST_BUCKETS 12
+
+// Allocator instrumentation (both engines combined)
+typedef struct HeapStats {
+    uint32_t alloc_calls;
+    uint32_t free_calls;
+    uint32_t failed_allocs;
+    uint32_t realloc_calls;
+    uint32_t realloc_in_place;  // reallocs served without moving data
+    HeapUsage usage;
+    uint32_t free_blocks;       // blocks on free lists
+    size_t free_bytes;          // bytes on free lists
+    size_t largest_free;        // largest single free block
+    uint32_t frag_pct;          // 100 * (1 - largest_free / free_bytes)
+    uint32_t size_hist[HEAP_HIST_BUCKETS];
+} HeapStats;
+
+void heap_get_stats(HeapStats* stats);
+void heap_print_stats(void);
+
 void memory_init(void);
 
 #endif
\ No newline at end of file
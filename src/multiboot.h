@@ -0,0 +1,42 @@
+/* multiboot.h - Multiboot (v1) boot information structures */
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include "types.h"
+
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002  /* Passed in EAX by the loader */
+
+/* multiboot_info_t.flags bits */
+#define MULTIBOOT_INFO_MEMORY       0x00000001  /* mem_lower/mem_upper valid */
+#define MULTIBOOT_INFO_CMDLINE      0x00000004  /* cmdline valid */
+#define MULTIBOOT_INFO_MEM_MAP      0x00000040  /* mmap_addr/mmap_length valid */
+
+/* Memory map entry types */
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
+/* Boot information handed to kmain (only the fields we use are named) */
+typedef struct multiboot_info {
+    uint32_t flags;
+    uint32_t mem_lower;         /* KB of memory below 1 MB */
+    uint32_t mem_upper;         /* KB of memory above 1 MB */
+    uint32_t boot_device;
+    uint32_t cmdline;           /* Physical address of the command line */
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;       /* Size of the memory map in bytes */
+    uint32_t mmap_addr;         /* Physical address of the first entry */
+} __attribute__((packed)) multiboot_info_t;
+
+/* Memory map entry; 64-bit fields are split since we run 32-bit only.
+ * 'size' does not count itself, so the next entry is at +size+4. */
+typedef struct multiboot_mmap_entry {
+    uint32_t size;
+    uint32_t addr_low;
+    uint32_t addr_high;
+    uint32_t len_low;
+    uint32_t len_high;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+#endif
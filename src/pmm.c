@@ -0,0 +1,269 @@
+/* pmm.c - Physical page-frame allocator
+ *
+ * One bit per 4 KB frame (1 = used). The bitmap lives right after the
+ * kernel image (__kernel_end), or after the boot information when the
+ * loader put that there (QEMU -kernel places the command line at the
+ * first page past the image), and is sized for the highest usable
+ * address reported by the multiboot memory map, so the allocator covers
+ * however much RAM the machine (or QEMU -m) provides.
+ */
+#include "pmm.h"
+#include "serial.h"
+#include "cpu.h"
+#include "spinlock.h"
+
+extern uint8_t __kernel_end[];     /* From link.ld */
+
+static uint32_t* frame_bitmap = NULL;
+static size_t frame_count = 0;      /* Frames covered by the bitmap */
+static size_t frames_free = 0;
+static size_t usable_frames = 0;    /* Frames available after boot reservations */
+static size_t search_hint = 0;      /* Word index to start searching from */
+static spinlock_t pmm_lock = SPINLOCK_INIT;
+
+static inline int frame_used(size_t f) {
+    return frame_bitmap[f >> 5] & (1u << (f & 31));
+}
+
+static inline void frame_set(size_t f) {
+    frame_bitmap[f >> 5] |= (1u << (f & 31));
+}
+
+static inline void frame_clear(size_t f) {
+    frame_bitmap[f >> 5] &= ~(1u << (f & 31));
+}
+
+/* Mark [start, end) as available, rounding inwards to whole frames */
+static void release_range(uint32_t start, uint32_t end) {
+    size_t first = (start + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    size_t last = end >> PAGE_SHIFT;
+
+    if (last > frame_count) last = frame_count;
+    for (size_t f = first; f < last; f++) {
+        if (frame_used(f)) {
+            frame_clear(f);
+            frames_free++;
+        }
+    }
+}
+
+/* Mark [start, end) as used, rounding outwards to whole frames */
+static void reserve_range(uint32_t start, uint32_t end) {
+    size_t first = start >> PAGE_SHIFT;
+    size_t last = (end + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+    if (last > frame_count) last = frame_count;
+    for (size_t f = first; f < last; f++) {
+        if (!frame_used(f)) {
+            frame_set(f);
+            frames_free--;
+        }
+    }
+}
+
+/* Clamp a 64-bit map entry to the 32-bit address space; 0 if unusable */
+static int entry_range(multiboot_mmap_entry_t* e, uint32_t* start, uint32_t* end) {
+    if (e->addr_high != 0)
+        return 0;                           /* Entirely above 4 GB */
+    *start = e->addr_low;
+    if (e->len_high != 0 || e->len_low > 0xFFFFFFFFu - e->addr_low)
+        *end = 0xFFFFF000u;                 /* Runs past 4 GB */
+    else
+        *end = e->addr_low + e->len_low;
+    return *end > *start;
+}
+
+/* Length of the boot command line including its terminator */
+static uint32_t cmdline_size(multiboot_info_t* mbi) {
+    const char* p = (const char*)mbi->cmdline;
+    uint32_t n = 1;
+
+    while (*p++)
+        n++;
+    return n;
+}
+
+/* Keep the multiboot info, memory map and command line out of the pool */
+static void reserve_boot_info(multiboot_info_t* mbi) {
+    reserve_range((uint32_t)mbi, (uint32_t)mbi + sizeof(*mbi));
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP)
+        reserve_range(mbi->mmap_addr, mbi->mmap_addr + mbi->mmap_length);
+    if (mbi->flags & MULTIBOOT_INFO_CMDLINE)
+        reserve_range(mbi->cmdline, mbi->cmdline + cmdline_size(mbi));
+}
+
+/* End of the highest piece of boot information */
+static uint32_t boot_info_end(multiboot_info_t* mbi) {
+    uint32_t top = (uint32_t)mbi + sizeof(*mbi);
+
+    if ((mbi->flags & MULTIBOOT_INFO_MEM_MAP) && mbi->mmap_addr + mbi->mmap_length > top)
+        top = mbi->mmap_addr + mbi->mmap_length;
+    if ((mbi->flags & MULTIBOOT_INFO_CMDLINE) && mbi->cmdline + cmdline_size(mbi) > top)
+        top = mbi->cmdline + cmdline_size(mbi);
+    return top;
+}
+
+void pmm_init(uint32_t magic, multiboot_info_t* mbi) {
+    uint32_t top = 0;
+    uint32_t start, end;
+
+    frame_bitmap = NULL;
+    frame_count = frames_free = usable_frames = search_hint = 0;
+
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC || !mbi) {
+        serial_puts("[PMM] No multiboot info - page allocator disabled\n");
+        return;
+    }
+
+    /* Pass 1: highest usable address decides the bitmap size */
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP) {
+        uint32_t p = mbi->mmap_addr;
+        while (p < mbi->mmap_addr + mbi->mmap_length) {
+            multiboot_mmap_entry_t* e = (multiboot_mmap_entry_t*)p;
+            if (e->type == MULTIBOOT_MEMORY_AVAILABLE && entry_range(e, &start, &end) && end > top)
+                top = end;
+            p += e->size + sizeof(e->size);
+        }
+    }
+    else if (mbi->flags & MULTIBOOT_INFO_MEMORY) {
+        top = 0x100000 + mbi->mem_upper * 1024;
+    }
+
+    if (top == 0) {
+        serial_puts("[PMM] Memory map empty - page allocator disabled\n");
+        return;
+    }
+
+    /* Bitmap starts fully used; available ranges are then released.
+     * It must not overwrite boot information the kernel still reads. */
+    frame_count = top >> PAGE_SHIFT;
+    start = (uint32_t)__kernel_end;
+    end = boot_info_end(mbi);
+    if (end > start)
+        start = (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    frame_bitmap = (uint32_t*)start;
+    size_t words = (frame_count + 31) / 32;
+    for (size_t i = 0; i < words; i++)
+        frame_bitmap[i] = 0xFFFFFFFF;
+
+    /* Pass 2: release every available range */
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP) {
+        uint32_t p = mbi->mmap_addr;
+        while (p < mbi->mmap_addr + mbi->mmap_length) {
+            multiboot_mmap_entry_t* e = (multiboot_mmap_entry_t*)p;
+            if (e->type == MULTIBOOT_MEMORY_AVAILABLE && entry_range(e, &start, &end))
+                release_range(start, end);
+            p += e->size + sizeof(e->size);
+        }
+    }
+    else {
+        release_range(0x100000, top);
+    }
+
+    /* Never hand out low memory, the kernel image, the boot information
+     * or the bitmap itself */
+    reserve_range(0, 0x100000);
+    reserve_range(0x100000, (uint32_t)__kernel_end);
+    reserve_boot_info(mbi);
+    reserve_range((uint32_t)frame_bitmap, (uint32_t)frame_bitmap + words * sizeof(uint32_t));
+    usable_frames = frames_free;
+}
+
+void* pmm_alloc_frame(void) {
+    return pmm_alloc_frames(1);
+}
+
+void pmm_free_frame(void* frame) {
+    pmm_free_frames(frame, 1);
+}
+
+/* First-fit search for 'count' clear bits, skipping full words at a time */
+static void* alloc_run(size_t count) {
+    size_t words = (frame_count + 31) / 32;
+
+    if (count == 0 || count > frames_free)
+        return NULL;
+
+    for (size_t pass = 0; pass < 2; pass++) {
+        size_t w = pass ? 0 : search_hint;
+        size_t w_end = pass ? search_hint : words;
+
+        for (; w < w_end; w++) {
+            if (frame_bitmap[w] == 0xFFFFFFFF)
+                continue;
+
+            /* Try every free frame in this word as the start of a run */
+            uint32_t free_bits = ~frame_bitmap[w];
+            while (free_bits) {
+                size_t first = w * 32 + bsf(free_bits);
+                size_t run = 0;
+
+                while (run < count && first + run < frame_count && !frame_used(first + run))
+                    run++;
+
+                if (run == count) {
+                    for (size_t f = first; f < first + count; f++)
+                        frame_set(f);
+                    frames_free -= count;
+                    search_hint = (first + count) / 32;
+                    return (void*)(first << PAGE_SHIFT);
+                }
+                if (first + run >= frame_count) {
+                    w = w_end;              /* Hit the end of memory */
+                    break;
+                }
+
+                /* Skip past the used frame that ended this run */
+                size_t next = first + run + 1;
+                if (next >= (w + 1) * 32)
+                    break;
+                free_bits &= ~((1u << (next & 31)) - 1);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void* pmm_alloc_frames(size_t count) {
+    uint32_t mask = spin_lock_irqsave(&pmm_lock);
+    void* frames = alloc_run(count);
+    spin_unlock_irqrestore(&pmm_lock, mask);
+    return frames;
+}
+
+void pmm_free_frames(void* frame, size_t count) {
+    size_t first = (uint32_t)frame >> PAGE_SHIFT;
+    uint32_t mask = spin_lock_irqsave(&pmm_lock);
+
+    for (size_t f = first; f < first + count && f < frame_count; f++) {
+        if (frame_used(f)) {
+            frame_clear(f);
+            frames_free++;
+        }
+    }
+
+    if (first / 32 < search_hint)
+        search_hint = first / 32;
+    spin_unlock_irqrestore(&pmm_lock, mask);
+}
+
+size_t pmm_total_frames(void) {
+    return usable_frames;
+}
+
+size_t pmm_free_frames_count(void) {
+    return frames_free;
+}
+
+void pmm_print_info(void) {
+    serial_puts("[PMM] ");
+    serial_putdec(usable_frames);
+    serial_puts(" usable frames, ");
+    serial_putdec(frames_free);
+    serial_puts(" free (");
+    serial_putdec(frames_free * (PAGE_SIZE / 1024));
+    serial_puts(" KB), bitmap at ");
+    serial_puthex((uint32_t)frame_bitmap);
+    serial_puts("\n");
+}
@@ -0,0 +1,27 @@
+/* pmm.h - Physical page-frame allocator */
+#ifndef PMM_H
+#define PMM_H
+
+#include "types.h"
+#include "multiboot.h"
+
+#define PAGE_SIZE   4096
+#define PAGE_SHIFT  12
+
+/* Build the frame bitmap from the multiboot memory map */
+void pmm_init(uint32_t magic, multiboot_info_t* mbi);
+
+/* Single frames */
+void* pmm_alloc_frame(void);
+void pmm_free_frame(void* frame);
+
+/* Physically contiguous runs of frames */
+void* pmm_alloc_frames(size_t count);
+void pmm_free_frames(void* frame, size_t count);
+
+/* Statistics */
+size_t pmm_total_frames(void);
+size_t pmm_free_frames_count(void);
+void pmm_print_info(void);
+
+#endif
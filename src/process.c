@@ -1,41 +1,126 @@
 #include "process.h"
 #include "memory.h"
 #include "serial.h"
+#include "string.h"
+#include "scheduler.h"
+#include "cpu.h"
+#include "pmm.h"
 
 /* Forward declaration for process exit handler */
 extern void user_process_exit(void);
 
+/* Entry trampoline for new processes (ctxsw.S) */
+extern void proc_start(void);
+
 // Process Table Creation
-pcb_t proctab[NPROC];
+pcb_t *proctab[NPROC_MAX];
+pcb_cold_t *proccold[NPROC_MAX];
+volatile int proctab_slots = 0;
+
+// Free slots, linked through pcb.next
+static int free_slots = -1;
+
+// Process table lock (currpid itself is per CPU, see process.h)
+spinlock_t proc_lock = SPINLOCK_INIT;
+
+// Take process stacks from the dedicated pool (0 = always use the heap)
+int proc_use_stack_pool = 1;
+
+// Print each process's peak stack use when it is released (0 = quiet)
+int proc_report_stacks = 0;
 
-// Initially, no current process
-pid32 currpid = -1;
+// Allocate a process stack, preferring the pool over the general heap
+// for the default size, and paint it so its peak use can be measured
+static char *alloc_stack(size_t size)
+{
+    char *stk = NULL;
+
+    if (proc_use_stack_pool && size == STACK_PER_PROC)
+        stk = (char *)stack_pool_alloc();
+    if (!stk)
+        stk = (char *)heap_alloc(size);
+    if (stk) {
+        for (size_t i = 0; i < size / 4; i++)
+            ((uint32_t *)stk)[i] = STACK_PAINT;
+    }
+    return stk;
+}
 
-// Next PID to assign
-static pid32 next_pid = 1;
+// Deepest stack use so far in bytes: the stack grows down from the top,
+// so count the painted words still intact above the base
+static size_t stack_peak(int slot)
+{
+    uint32_t *w = (uint32_t *)proccold[slot]->prstkbase;
+    size_t size = proccold[slot]->prstksize;
+    size_t n = 0;
+
+    if (!w)
+        return 0;
+    while (n < size / 4 && w[n] == STACK_PAINT)
+        n++;
+    return size - n * 4;
+}
 
-// Ready queue
-queue_t readylist = {-1, -1};
+// "[STACK] pid N: peak P of S bytes", flagging a stack used to its base
+static void stack_report(int slot, const char *when)
+{
+    size_t peak = stack_peak(slot);
+
+    serial_puts("[STACK] pid ");
+    serial_putdec(proctab[slot]->pid);
+    serial_puts(" ");
+    serial_puts(when);
+    serial_puts(": peak ");
+    serial_putdec(peak);
+    serial_puts(" of ");
+    serial_putdec(proccold[slot]->prstksize);
+    serial_puts(peak == proccold[slot]->prstksize ? " bytes, may have overflowed\n"
+                                                  : " bytes\n");
+}
 
-#define STACK_PER_PROC 512 // Process stack size
+// Release a process stack to wherever it came from
+static void free_stack(char *stk)
+{
+    if (!stack_pool_free(stk))
+        heap_free(stk);
+}
 
 // Queue operations
 void q_insert(int slot, queue_t *q)
 {
-    if (slot < 0 || slot >= NPROC || !q)
+    if (slot < 0 || slot >= proctab_slots || !q)
         return;
 
-    proctab[slot].next = -1; // Mark end of queue
+    proctab[slot]->next = -1; // Mark end of queue
+    proctab[slot]->prev = q->tail;
 
     if (q->head == -1) {
         // Queue empty
         q->head = slot;
-        q->tail = slot;
     } else {
         // Add behind tail
-        proctab[q->tail].next = slot;
-        q->tail = slot;
+        proctab[q->tail]->next = slot;
     }
+    q->tail = slot;
+    q->count++;
+}
+
+// Unlink a slot from anywhere in the queue (it must be on q)
+void q_delete(int slot, queue_t *q)
+{
+    if (proctab[slot]->prev == -1)
+        q->head = proctab[slot]->next;
+    else
+        proctab[proctab[slot]->prev]->next = proctab[slot]->next;
+
+    if (proctab[slot]->next == -1)
+        q->tail = proctab[slot]->prev;
+    else
+        proctab[proctab[slot]->next]->prev = proctab[slot]->prev;
+
+    proctab[slot]->next = -1;
+    proctab[slot]->prev = -1;
+    q->count--;
 }
 
 int q_remove(queue_t *q)
@@ -46,12 +131,7 @@ int q_remove(queue_t *q)
         return -1; // Queue empty
 
     slot = q->head;
-    q->head = proctab[slot].next;
-
-    if (q->head == -1)
-        q->tail = -1; // Queue now empty
-
-    proctab[slot].next = -1;
+    q_delete(slot, q);
     return slot;
 }
 
@@ -63,51 +143,168 @@ int q_empty(queue_t *q)
 // Enqueue a process to ready list
 void enqueue_ready(int slot)
 {
-    if (slot < 0 || slot >= NPROC)
+    if (slot < 0 || slot >= proctab_slots)
         return;
 
-    proctab[slot].prstate = PR_READY;
-    q_insert(slot, &readylist);
+    proctab[slot]->prstate = PR_READY;
+    sched_ready_insert(slot);
 }
 
-// Returns next ready process PID
+// Slot of the oldest ready process queued on this CPU, -1 if none
 pid32 get_next_ready(void)
 {
-    if (q_empty(&readylist))
+    return sched_ready_head(cpu_self()->id);
+}
+
+// Put a PCB (both halves) in the free state
+static void pcb_reset(pcb_t *p, pcb_cold_t *c)
+{
+    p->pid = -1; 
+    p->prstate = PR_FREE;
+    p->prprio = 0;
+    p->prstkptr = NULL;
+    c->prstkbase = NULL;
+    c->prstksize = 0;
+    p->next = -1;
+    p->prev = -1;
+    p->prqnext = -1;
+    p->prqprev = -1;
+    p->prqlevel = -1;
+    p->prmqnext = -1;
+    p->prmqprev = -1;
+    p->prmlevel = 0;
+    p->prmallot = MLFQ_ALLOTMENT(0);
+    p->prcpu = 0;
+    
+    // Initialize scheduler fields
+    p->prfunc = NULL;
+    p->prquantum = 10;  // Default quantum
+    p->prtime = 10;
+    p->prtickets = STRIDE_DEFAULT_TICKETS;
+    p->prpass = 0;
+    p->prrt = 0;
+    c->prmisses = 0;
+    c->prrelnext = -1;
+    c->prrelprev = -1;
+    c->prdlnext = -1;
+    c->prdlprev = -1;
+    c->prfpucpu = -1;
+    c->prrtnext = -1;
+    c->prrtprev = -1;
+    c->prsleepnext = -1;
+    c->original_prio = 0;
+    p->prready_since = 0;
+    p->prcputime = 0;
+    p->prpinned = 0;
+    c->prfpu = NULL;
+    p->prheappos = -1;
+    
+    // Initialize IPC fields
+    c->has_msg = 0;
+    c->sender_pid = -1;
+    c->msg_inbox.len = 0;
+    c->msg_inbox.sender_pid = -1;
+}
+
+// The hot half is two cache lines, with the scan fields in the first
+_Static_assert(sizeof(pcb_t) == 2 * CACHE_LINE, "pcb_t must stay two cache lines");
+_Static_assert(__builtin_offsetof(pcb_t, prpass) == CACHE_LINE,
+               "scan fields must fill exactly the first line of pcb_t");
+
+// PCBs per page of the table
+#define PCBS_PER_PAGE  (PAGE_SIZE / sizeof(pcb_t))
+
+// Pages of cold halves that go with one page of PCBs
+#define COLD_PAGES  ((PCBS_PER_PAGE * sizeof(pcb_cold_t) + PAGE_SIZE - 1) / PAGE_SIZE)
+
+// The first page of PCBs is static, so processes can be created even
+// when the frame allocator is off (no multiboot memory map)
+static pcb_t proctab_boot[PCBS_PER_PAGE];
+static pcb_cold_t proccold_boot[PCBS_PER_PAGE];
+
+// Add a page of PCBs to the table (proc_lock held, or during init)
+static int proctab_grow(void)
+{
+    pcb_t *page;
+    pcb_cold_t *cold;
+    int n, i;
+
+    if (proctab_slots >= NPROC_MAX)
         return -1;
+    if (proctab_slots == 0) {
+        page = proctab_boot;
+        cold = proccold_boot;
+    } else {
+        page = (pcb_t *)pmm_alloc_frame();
+        if (!page)
+            return -1;
+        cold = (pcb_cold_t *)pmm_alloc_frames(COLD_PAGES);
+        if (!cold) {
+            pmm_free_frame(page);
+            return -1;
+        }
+    }
 
-    return readylist.head;
+    n = PCBS_PER_PAGE;
+    if (n > NPROC_MAX - proctab_slots)
+        n = NPROC_MAX - proctab_slots;
+
+    // Last slot pushed first so the lowest comes off the free list first
+    for (i = n - 1; i >= 0; i--) {
+        pcb_reset(&page[i], &cold[i]);
+        cold[i].prgen = 0;
+        page[i].next = free_slots;
+        free_slots = proctab_slots + i;
+        proctab[proctab_slots + i] = &page[i];
+        proccold[proctab_slots + i] = &cold[i];
+    }
+
+    // Unlocked readers (find_slot) check the bound before the pointer
+    __sync_synchronize();
+    proctab_slots += n;
+    return 0;
+}
+
+// Take a free slot, growing the table if none is left
+static int alloc_slot(void)
+{
+    int slot;
+
+    if (free_slots == -1 && proctab_grow() < 0)
+        return -1;
+    slot = free_slots;
+    free_slots = proctab[slot]->next;
+    proctab[slot]->next = -1;
+    return slot;
+}
+
+// Give a slot back to the free list
+static void free_slot(int slot)
+{
+    proctab[slot]->next = free_slots;
+    free_slots = slot;
+}
+
+// Next pid for a slot: bump its generation so old pids stop matching
+static pid32 slot_pid(int slot)
+{
+    pcb_cold_t *c = proccold[slot];
+
+    c->prgen = c->prgen % PID_GEN_MAX + 1;
+    return (c->prgen << PID_SLOT_BITS) | slot;
 }
 
 // Initialize process table
 void init_proctab(void)
 {
-    for (int i = 0; i < NPROC; i++)
+    free_slots = -1;
+    for (int i = proctab_slots - 1; i >= 0; i--)
     {
-        proctab[i].pid = -1; 
-        proctab[i].prstate = PR_FREE;
-        proctab[i].prprio = 0;
-        proctab[i].prstkptr = NULL;
-        proctab[i].prstkbase = NULL;
-        proctab[i].next = -1;
-        
-        // Initialize scheduler fields
-        proctab[i].prfunc = NULL;
-        proctab[i].prquantum = 10;  // Default quantum
-        proctab[i].prtime = 10;
-        proctab[i].original_prio = 0;
-        proctab[i].prwait_time = 0;
-        proctab[i].prcputime = 0;
-        
-        // Initialize IPC fields
-        proctab[i].has_msg = 0;
-        proctab[i].sender_pid = -1;
-        proctab[i].msg_inbox.len = 0;
-        proctab[i].msg_inbox.sender_pid = -1;
+        pcb_reset(proctab[i], proccold[i]);
+        free_slot(i);
     }
-    next_pid = 1;
-    readylist.head = -1;
-    readylist.tail = -1;
+    if (proctab_slots == 0)
+        proctab_grow();
     currpid = -1;
 }
 
@@ -118,254 +315,300 @@ pid32 create_process(int priority)
 {
     int i;
     char *stkbase;
+    uint32_t mask;
 
-    // 1. Find a free slot
-    for (i = 0; i < NPROC; i++)
-    {
-        if (proctab[i].prstate == PR_FREE)
-            break;
-    }
-
-    if (i == NPROC)
-        return -1; // No free process slot
-
-    // 2. Allocate kernel stack
-    stkbase = (char *)heap_alloc(STACK_PER_PROC);
+    // 1. Allocate and paint the kernel stack before taking the lock
+    stkbase = alloc_stack(STACK_PER_PROC);
     if (!stkbase)
         return -1; // Memory allocation failed
 
+    mask = spin_lock_irqsave(&proc_lock);
+
+    // 2. Find a free slot
+    i = alloc_slot();
+    if (i == -1) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        free_stack(stkbase);
+        return -1; // No free process slot
+    }
+
     // 3. Initialize PCB
-    proctab[i].pid = next_pid++;
-    proctab[i].prstate = PR_READY;
-    proctab[i].prprio = priority;
-    proctab[i].prstkbase = stkbase;
-    proctab[i].prstkptr = stkbase + STACK_PER_PROC - 4; // stack grows down
-    proctab[i].next = -1;
+    proctab[i]->pid = slot_pid(i);
+    proctab[i]->prstate = PR_READY;
+    proctab[i]->prprio = priority;
+    proccold[i]->prstkbase = stkbase;
+    proccold[i]->prstksize = STACK_PER_PROC;
+    proctab[i]->prstkptr = stkbase + STACK_PER_PROC - 4; // stack grows down
+    proctab[i]->next = -1;
+    proctab[i]->prmlevel = 0;    // New processes start at the top MLFQ level
+    proctab[i]->prmallot = MLFQ_ALLOTMENT(0);
+    proctab[i]->prcpu = 0;       // No entry point: only ever run by hand on CPU 0
+    proctab[i]->prpinned = 0;
     
     // Initialize scheduler fields
-    proctab[i].prfunc = NULL;
-    proctab[i].prquantum = 10;  // Default quantum
-    proctab[i].prtime = 10;
-    proctab[i].original_prio = priority;
-    proctab[i].prwait_time = 0;
-    proctab[i].prcputime = 0;
+    proctab[i]->prfunc = NULL;
+    proctab[i]->prquantum = 10;  // Default quantum
+    proctab[i]->prtime = 10;
+    proctab[i]->prtickets = STRIDE_DEFAULT_TICKETS;
+    proctab[i]->prpass = 0;      // Raised to its CPU's pass when queued
+    proctab[i]->prrt = 0;        // Best effort until set_realtime()
+    proccold[i]->prmisses = 0;
+    proccold[i]->original_prio = priority;
+    proctab[i]->prcputime = 0;
+    proccold[i]->prfpu = NULL;    // No FPU state until it uses the FPU
+    proccold[i]->prfpucpu = -1;
     
     // Initialize IPC fields
-    proctab[i].has_msg = 0;
-    proctab[i].sender_pid = -1;
-    proctab[i].msg_inbox.len = 0;
-    proctab[i].msg_inbox.sender_pid = -1;
+    proccold[i]->has_msg = 0;
+    proccold[i]->sender_pid = -1;
+    proccold[i]->msg_inbox.len = 0;
+    proccold[i]->msg_inbox.sender_pid = -1;
 
     // 4. Enqueue to ready queue
     enqueue_ready(i);
+    spin_unlock_irqrestore(&proc_lock, mask);
 
-    return proctab[i].pid;
+    return proctab[i]->pid;
 }
 
-// Create a new process with a function pointer
-pid32 create_process_with_func(int priority, void (*func)(void))
+// Create a process with an entry point, placed on the least-loaded CPU
+// or pinned to the calling one
+static pid32 create_func_process(int priority, void (*func)(void), size_t stack_size, int pinned)
 {
     int i;
     char *stkbase;
     uint32_t *stkptr;
+    uint32_t mask;
 
-    // 1. Find a free slot
-    for (i = 0; i < NPROC; i++)
-    {
-        if (proctab[i].prstate == PR_FREE)
-            break;
-    }
+    if (stack_size < STACK_MIN)
+        return -1; // Too small for the switch frame and an interrupt
+    if (stack_size > STACK_MAX)
+        return -1; // Checked before rounding, which could wrap to 0
+    stack_size = (stack_size + 15) & ~(size_t)15;
 
-    if (i == NPROC)
-        return -1; // No free process slot
-
-    // 2. Allocate kernel stack
-    stkbase = (char *)heap_alloc(STACK_PER_PROC);
+    // 1. Allocate and paint the kernel stack before taking the lock
+    stkbase = alloc_stack(stack_size);
     if (!stkbase)
         return -1; // Memory allocation failed
 
+    mask = spin_lock_irqsave(&proc_lock);
+
+    // 2. Find a free slot
+    i = alloc_slot();
+    if (i == -1) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        free_stack(stkbase);
+        return -1; // No free process slot
+    }
+
     // 3. Initialize stack for context switch
     // Stack layout for ctxsw: EBX, ESI, EDI, EBP, return_address
-    // ctxsw will pop EBX, ESI, EDI, EBP, then RET to return_address
+    // ctxsw will pop EBX, ESI, EDI, EBP, then RET to proc_start,
+    // which enables interrupts and calls the function in EBX
     
-    stkptr = (uint32_t *)(stkbase + STACK_PER_PROC);
+    stkptr = (uint32_t *)(stkbase + stack_size);
     
-    *(--stkptr) = (uint32_t)func;    // Return address (entry point)
+    *(--stkptr) = (uint32_t)proc_start;  // Return address (trampoline)
     *(--stkptr) = 0;                 // EBP
     *(--stkptr) = 0;                 // EDI
     *(--stkptr) = 0;                 // ESI  
-    *(--stkptr) = 0;                 // EBX
+    *(--stkptr) = (uint32_t)func;    // EBX (entry point)
 
     // 4. Initialize PCB
-    proctab[i].pid = next_pid++;
-    proctab[i].prstate = PR_READY;
-    proctab[i].prprio = priority;
-    proctab[i].prstkbase = stkbase;
-    proctab[i].prstkptr = (char *)stkptr;  // Point to prepared stack
-    proctab[i].next = -1;
+    proctab[i]->pid = slot_pid(i);
+    proctab[i]->prstate = PR_READY;
+    proctab[i]->prprio = priority;
+    proccold[i]->prstkbase = stkbase;
+    proccold[i]->prstksize = stack_size;
+    proctab[i]->prstkptr = (char *)stkptr;  // Point to prepared stack
+    proctab[i]->next = -1;
+    proctab[i]->prmlevel = 0;    // New processes start at the top MLFQ level
+    proctab[i]->prmallot = MLFQ_ALLOTMENT(0);
+    proctab[i]->prcpu = pinned ? cpu_self()->id : sched_home_cpu();
+    proctab[i]->prpinned = pinned;
     
     // Initialize scheduler fields
-    proctab[i].prfunc = func;
-    proctab[i].prquantum = 10;  // Default quantum
-    proctab[i].prtime = 10;
-    proctab[i].original_prio = priority;
-    proctab[i].prwait_time = 0;
-    proctab[i].prcputime = 0;
+    proctab[i]->prfunc = func;
+    proctab[i]->prquantum = 10;  // Default quantum
+    proctab[i]->prtime = 10;
+    proctab[i]->prtickets = STRIDE_DEFAULT_TICKETS;
+    proctab[i]->prpass = 0;      // Raised to its CPU's pass when queued
+    proctab[i]->prrt = 0;        // Best effort until set_realtime()
+    proccold[i]->prmisses = 0;
+    proccold[i]->original_prio = priority;
+    proctab[i]->prcputime = 0;
+    proccold[i]->prfpu = NULL;    // No FPU state until it uses the FPU
+    proccold[i]->prfpucpu = -1;
     
     // Initialize IPC fields
-    proctab[i].has_msg = 0;
-    proctab[i].sender_pid = -1;
-    proctab[i].msg_inbox.len = 0;
-    proctab[i].msg_inbox.sender_pid = -1;
+    proccold[i]->has_msg = 0;
+    proccold[i]->sender_pid = -1;
+    proccold[i]->msg_inbox.len = 0;
+    proccold[i]->msg_inbox.sender_pid = -1;
 
     // 5. Enqueue to ready queue
     enqueue_ready(i);
+    spin_unlock_irqrestore(&proc_lock, mask);
 
-    return proctab[i].pid;
+    return proctab[i]->pid;
+}
+
+// Create a new process with a function pointer
+pid32 create_process_with_func(int priority, void (*func)(void))
+{
+    return create_process_with_stack(priority, func, STACK_PER_PROC);
+}
+
+// Create a new process with a function pointer and its own stack size
+// (rounded up to 16 bytes, STACK_MIN to STACK_MAX)
+pid32 create_process_with_stack(int priority, void (*func)(void), size_t stack_size)
+{
+    return create_func_process(priority, func, stack_size, 0);
+}
+
+// Create a new process that runs only on the calling CPU
+pid32 create_process_pinned(int priority, void (*func)(void))
+{
+    return create_func_process(priority, func, STACK_PER_PROC, 1);
 }
 
 // Remove a process from ready queue
 void dequeue_process(int slot)
 {
-    int curr, prev;
-    
-    if (slot < 0 || slot >= NPROC)
+    if (slot < 0 || slot >= proctab_slots)
         return;
     
     // If not in ready state, nothing to dequeue
-    if (proctab[slot].prstate != PR_READY)
+    if (proctab[slot]->prstate != PR_READY)
         return;
-    
-    // Search for process in ready queue
-    prev = -1;
-    curr = readylist.head;
-    
-    while (curr != -1) {
-        if (curr == slot) {
-            // Found it - remove from queue
-            if (prev == -1) {
-                // Removing head
-                readylist.head = proctab[curr].next;
-                if (readylist.head == -1)
-                    readylist.tail = -1;
-            } else {
-                // Removing from middle or tail
-                proctab[prev].next = proctab[curr].next;
-                if (curr == readylist.tail)
-                    readylist.tail = prev;
-            }
-            proctab[curr].next = -1;
-            return;
-        }
-        prev = curr;
-        curr = proctab[curr].next;
-    }
+
+    sched_ready_remove(slot);
 }
 
 // Set a process as currently running
 void set_current(pid32 pid)
 {
-    int slot = find_slot(pid);
-    int old_slot, i;
-    queue_t temp;
+    int slot;
+    int old_slot;
+    uint32_t mask;
 
-    if (slot == -1)
+    // Look up the slot under the lock so it can't be recycled under us
+    mask = spin_lock_irqsave(&proc_lock);
+
+    slot = find_slot(pid);
+    if (slot == -1) {
+        spin_unlock_irqrestore(&proc_lock, mask);
         return; // Not found
+    }
 
     // Move old current back to READY and add to ready queue
     if (currpid != -1)
     {
         old_slot = find_slot(currpid);
-        if (old_slot != -1 && proctab[old_slot].prstate == PR_CURR)
+        if (old_slot != -1 && proctab[old_slot]->prstate == PR_CURR)
         {
-            proctab[old_slot].prstate = PR_READY;
-            q_insert(old_slot, &readylist);
+            enqueue_ready(old_slot);
         }
     }
 
     // Remove new current from ready queue
-    if (proctab[slot].prstate == PR_READY)
+    if (proctab[slot]->prstate == PR_READY)
     {
-        // Rebuild queue without this process
-        temp.head = -1;
-        temp.tail = -1;
-        while (!q_empty(&readylist))
-        {
-            i = q_remove(&readylist);
-            if (i != slot)
-                q_insert(i, &temp);
-        }
-        readylist = temp;
+        sched_ready_remove(slot);
     }
 
-    proctab[slot].prstate = PR_CURR;
+    proctab[slot]->prstate = PR_CURR;
     currpid = pid;
+    spin_unlock_irqrestore(&proc_lock, mask);
 }
 
 // Terminate a process
 int terminate_process(pid32 pid)
 {
     int slot = find_slot(pid);
-    int i;
-    queue_t temp;
     int state;
+    uint32_t mask;
 
     if (slot == -1)
         return -1; // Not found
 
+    mask = spin_lock_irqsave(&proc_lock);
     state = get_process_state(pid);
 
-    // Remove from ready queue if present
-    if (state == PR_READY)
+    // Exited meanwhile, or running on another CPU (its stack is in use)
+    if (state == -1 || (state == PR_CURR && pid != currpid))
     {
-        // Rebuild queue without this process
-        temp.head = -1;
-        temp.tail = -1;
-        while (!q_empty(&readylist))
-        {
-            i = q_remove(&readylist);
-            if (i != slot)
-                q_insert(i, &temp);
-        }
-        readylist = temp;
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return -1;
     }
 
-    // Free stack
-    if (proctab[slot].prstkbase)
+    // Take a sleeper off the sleep queue
+    if (state == PR_SLEEP)
+        sched_sleep_remove(slot);
+
+    // Remove from ready queue if present
+    if (state == PR_READY)
     {
-        heap_free((void *)proctab[slot].prstkbase);
-        proctab[slot].prstkbase = NULL;
-        proctab[slot].prstkptr = NULL;
+        sched_ready_remove(slot);
     }
 
-    proctab[slot].prstate = PR_FREE;
-    proctab[slot].pid = -1;
-    proctab[slot].next = -1;
+    proc_release(slot);
 
     if (currpid == pid)
         currpid = -1;
+    spin_unlock_irqrestore(&proc_lock, mask);
 
     return 0;
 }
 
+// Free a process's stack and its table slot (proc_lock held).
+// A process that exits itself is released by the scheduler only after
+// its CPU has switched off its stack.
+void proc_release(int slot)
+{
+    // Give back its share of real-time utilization
+    rt_release(slot);
+
+    // Free stack
+    if (proccold[slot]->prstkbase)
+    {
+        if (proc_report_stacks || stack_peak(slot) == proccold[slot]->prstksize)
+            stack_report(slot, "released");
+        free_stack(proccold[slot]->prstkbase);
+        proccold[slot]->prstkbase = NULL;
+        proctab[slot]->prstkptr = NULL;
+    }
+
+    proctab[slot]->prstate = PR_FREE;
+    proctab[slot]->pid = -1;
+    free_slot(slot);
+}
+
 /* ============= UTILITY/ACCESSOR FUNCTIONS ============= */
 
 // Get current process ID
 pid32 getpid(void)
 {
-    return currpid;
+    // Interrupts off so the process cannot migrate between reading its
+    // CPU and that CPU's currpid
+    uint32_t mask = irq_disable();
+    pid32 pid = currpid;
+    irq_restore(mask);
+    return pid;
 }
 
-// Find process table slot index by PID
+// Find process table slot index by PID: the slot is in the pid itself,
+// and the full pid only matches while that process owns the slot
 int find_slot(pid32 pid)
 {
-    int i;
-    for (i = 0; i < NPROC; i++)
-    {
-        if (proctab[i].pid == pid)
-            return i;
-    }
-    return -1;  // Not found
+    int slot;
+
+    if (pid <= 0)
+        return -1;
+    slot = pid & PID_SLOT_MASK;
+    if (slot >= proctab_slots || proctab[slot]->pid != pid)
+        return -1;  // Not found, or the slot has been reused
+    return slot;
 }
 
 // Get process state
@@ -374,7 +617,7 @@ int get_process_state(pid32 pid)
     int slot = find_slot(pid);
     if (slot == -1)
         return -1;  // Not found
-    return proctab[slot].prstate;
+    return proctab[slot]->prstate;
 }
 
 // Get process priority
@@ -383,7 +626,7 @@ int get_process_priority(pid32 pid)
     int slot = find_slot(pid);
     if (slot == -1)
         return -1;  // Not found
-    return proctab[slot].prprio;
+    return proctab[slot]->prprio;
 }
 
 // Check if PID is valid (process exists and is not free)
@@ -392,7 +635,7 @@ int is_valid_pid(pid32 pid)
     int slot = find_slot(pid);
     if (slot == -1)
         return 0;  // Not found
-    return (proctab[slot].prstate != PR_FREE);
+    return (proctab[slot]->prstate != PR_FREE);
 }
 
 // Get process stack base
@@ -401,20 +644,43 @@ char* get_stack_base(pid32 pid)
     int slot = find_slot(pid);
     if (slot == -1)
         return NULL;  // Not found
-    return proctab[slot].prstkbase;
+    return proccold[slot]->prstkbase;
 }
 
-// Get number of ready processes in queue
-int get_num_ready(void)
+// Get process stack size in bytes
+size_t get_stack_size(pid32 pid)
 {
-    int count = 0;
-    int slot = readylist.head;
-    while (slot != -1)
-    {
-        count++;
-        slot = proctab[slot].next;
+    int slot = find_slot(pid);
+    if (slot == -1)
+        return 0;  // Not found
+    return proccold[slot]->prstksize;
+}
+
+// Get the most stack a process has used so far, in bytes
+size_t get_stack_peak(pid32 pid)
+{
+    int slot = find_slot(pid);
+    if (slot == -1)
+        return 0;  // Not found
+    return stack_peak(slot);
+}
+
+// Peak stack use of every live process
+void print_stacks(void)
+{
+    uint32_t mask = spin_lock_irqsave(&proc_lock);
+
+    for (int i = 0; i < proctab_slots; i++) {
+        if (proctab[i]->prstate != PR_FREE && proccold[i]->prstkbase)
+            stack_report(i, "now");
     }
-    return count;
+    spin_unlock_irqrestore(&proc_lock, mask);
+}
+
+// Get number of ready processes, over all CPUs
+int get_num_ready(void)
+{
+    return sched_ready_count();
 }
 
 /* ============= IPC (Inter-Process Communication) ============= */
@@ -423,10 +689,8 @@ int get_num_ready(void)
 // Returns 0 on success, -1 on failure
 int send(pid32 dest_pid, char *message, int len)
 {
-    int dest_slot = find_slot(dest_pid);
-    
-    if (dest_slot == -1)
-        return -1;  // Destination process not found
+    int dest_slot;
+    uint32_t mask;
     
     if (message == NULL || len <= 0)
         return -1;  // Invalid message
@@ -434,18 +698,26 @@ int send(pid32 dest_pid, char *message, int len)
     if (len > MSG_SIZE)
         len = MSG_SIZE;  // Truncate if too long
     
+    // Look up the slot under the lock so it can't be recycled under us
+    mask = spin_lock_irqsave(&proc_lock);
+
+    dest_slot = find_slot(dest_pid);
+    if (dest_slot == -1) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return -1;  // Destination process not found
+    }
+
     // Copy message to destination inbox
-    proctab[dest_slot].msg_inbox.sender_pid = currpid;
-    proctab[dest_slot].msg_inbox.len = len;
+    proccold[dest_slot]->msg_inbox.sender_pid = currpid;
+    proccold[dest_slot]->msg_inbox.len = len;
     
     // Copy message data
-    int i;
-    for (i = 0; i < len; i++)
-        proctab[dest_slot].msg_inbox.data[i] = message[i];
+    memcpy(proccold[dest_slot]->msg_inbox.data, message, len);
     
     // Mark that message is available
-    proctab[dest_slot].has_msg = 1;
-    proctab[dest_slot].sender_pid = currpid;
+    proccold[dest_slot]->has_msg = 1;
+    proccold[dest_slot]->sender_pid = currpid;
+    spin_unlock_irqrestore(&proc_lock, mask);
     
     return 0;
 }
@@ -455,34 +727,44 @@ int send(pid32 dest_pid, char *message, int len)
 // Returns number of bytes received, -1 on failure
 int receive(pid32 src_pid, char *buffer, int max_len)
 {
-    int my_slot = find_slot(currpid);
-    
-    if (my_slot == -1)
-        return -1;  // Current process not found
+    int my_slot;
+    int msg_len;
+    uint32_t mask;
     
     if (buffer == NULL || max_len <= 0)
         return -1;  // Invalid buffer
     
+    mask = spin_lock_irqsave(&proc_lock);
+
+    my_slot = find_slot(currpid);
+    if (my_slot == -1) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return -1;  // Current process not found
+    }
+
     // Check if message available
-    if (!proctab[my_slot].has_msg)
+    if (!proccold[my_slot]->has_msg) {
+        spin_unlock_irqrestore(&proc_lock, mask);
         return -1;  // No message waiting
+    }
     
     // If src_pid specified, check sender matches
-    if (src_pid != -1 && proctab[my_slot].msg_inbox.sender_pid != src_pid)
+    if (src_pid != -1 && proccold[my_slot]->msg_inbox.sender_pid != src_pid) {
+        spin_unlock_irqrestore(&proc_lock, mask);
         return -1;  // Message not from requested sender
+    }
     
     // Copy message to buffer
-    int msg_len = proctab[my_slot].msg_inbox.len;
+    msg_len = proccold[my_slot]->msg_inbox.len;
     if (msg_len > max_len)
         msg_len = max_len;  // Truncate to buffer size
     
-    int i;
-    for (i = 0; i < msg_len; i++)
-        buffer[i] = proctab[my_slot].msg_inbox.data[i];
+    memcpy(buffer, proccold[my_slot]->msg_inbox.data, msg_len);
     
     // Clear message
-    proctab[my_slot].has_msg = 0;
-    proctab[my_slot].msg_inbox.len = 0;
+    proccold[my_slot]->has_msg = 0;
+    proccold[my_slot]->msg_inbox.len = 0;
+    spin_unlock_irqrestore(&proc_lock, mask);
     
     return msg_len;  // Return bytes received
 }
@@ -1,8 +1,32 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
-// Max number of processes
-#define NPROC 8
+#include "types.h"
+#include "smp.h"
+#include "spinlock.h"
+
+// Process table size. The first page of PCBs is static; more are
+// allocated from the frame allocator a page at a time as the table
+// fills, up to NPROC_MAX slots. A pid carries its slot in the low
+// PID_SLOT_BITS and the slot's generation above them, so finding a
+// process is one array index and a stale pid never matches a reused slot.
+#define PID_SLOT_BITS   12
+#define NPROC_MAX       (1 << PID_SLOT_BITS)
+#define PID_SLOT_MASK   (NPROC_MAX - 1)
+#define PID_GEN_MAX     (0x7FFFFFFF >> PID_SLOT_BITS)   // Keeps pids positive
+
+// Process stacks: STACK_PER_PROC (memory.h) unless created with
+// create_process_with_stack(). New stacks are filled with STACK_PAINT so
+// the deepest point a process reached shows as the first overwritten word.
+// The timer interrupt runs the scheduler on the interrupted process's
+// stack: ISR frame, dispatch, sched_tick, resched_for, run_next,
+// steal_slot and the ctxsw frame take about 440 bytes (-fstack-usage,
+// -O2). STACK_IRQ_DEPTH rounds that up, and STACK_MIN leaves a process
+// as much again for its own frames.
+#define STACK_IRQ_DEPTH 512
+#define STACK_MIN   (2 * STACK_IRQ_DEPTH)
+#define STACK_MAX   (1024 * 1024)
+#define STACK_PAINT 0x5A5A5A5A
 
 // Process states
 #define PR_FREE     0   // Slot unused / terminated
@@ -11,6 +35,8 @@
 #define PR_BLOCKED  3   // Waiting for I/O
 #define PR_WAITING  4   // Waiting for message/event
 #define PR_SUSPEND  5   // Suspended by user
+#define PR_DEAD     6   // Exited; stack released once its CPU switches away
+#define PR_SLEEP    7   // On the sleep queue until its wake-up tick
 
 // Process ID type
 typedef int pid32;
@@ -25,59 +51,129 @@ typedef struct message
     int len;               // Message length
 } Message;
 
-// Process Control Block (PCB) structure
+// Process Control Block (PCB), split in two. pcb_t holds what the
+// scheduler reads for every process on every decision and every scan
+// over the table, packed into two cache lines with the fields scans
+// test in the first. pcb_cold_t holds the rest, read only when a
+// process is created or released, sleeps, uses the FPU, IPC or the
+// real-time class. Only prrt stays hot, so a scan can tell real-time
+// processes apart without touching the cold half. proctab itself holds
+// pointers, so a scan also reads one pointer per slot, 16 to a line;
+// the PCBs of one table page are contiguous.
+#define CACHE_LINE  64
+
 typedef struct pcb
 {
-    pid32 pid;              // Process ID
+    // First line: process identity and queue links
+    pid32 pid;              // Process ID (-1 while the slot is free)
     int prstate;            // Process state
     int prprio;             // Priority
-    char *prstkptr;         // Saved stack pointer
-    char *prstkbase;        // Base of stack
-    int next;               // Next process in queue (slot index)
-    
-    // Scheduler fields
+    int prcpu;              // CPU whose run queue holds this process
     void (*prfunc)(void);   // Process function pointer
+    int prrt;               // 1 if admitted as a real-time process
+    int prmlevel;           // MLFQ level (0 = top, shortest quantum)
+    uint32_t prready_since; // Aging clock when it last became READY
+    int next;               // Next in its CPU's arrival queue, or next free slot
+    int prev;               // Previous in its CPU's arrival queue
+    int prqnext;            // Next in per-priority ready queue
+    int prqprev;            // Previous in per-priority ready queue
+    int prqlevel;           // Priority queue holding this process (-1 = none)
+    int prmqnext;           // Next in MLFQ level queue
+    int prmqprev;           // Previous in MLFQ level queue
+    int prtickets;          // Stride scheduling: share of the CPU
+
+    // Second line: switching and accounting
+    uint32_t prpass;        // Stride scheduling: virtual time used so far
+    char *prstkptr;         // Saved stack pointer
     int prquantum;          // Time quantum allocated
     int prtime;             // Remaining time in current quantum
-    int original_prio;      // Original priority (for aging)
-    int prwait_time;        // Time spent waiting
+    int prmallot;           // MLFQ ticks left at prmlevel before demotion
     int prcputime;          // Total CPU time consumed
-    
+    int prpinned;           // 1 if it stays on prcpu (never stolen)
+    int prheappos;          // Index in its CPU's stride heap (-1 = none)
+} __attribute__((aligned(CACHE_LINE))) pcb_t;
+
+typedef struct pcb_cold
+{
+    int prgen;              // Generation of this slot, the high bits of pid
+    char *prstkbase;        // Base of stack
+    size_t prstksize;       // Stack size in bytes
+    int original_prio;      // Priority given at creation
+
+    // Real-time (EDF) parameters and job state, in timer ticks
+    uint32_t prperiod;      // Time between job releases
+    uint32_t prbudget;      // CPU time allowed per job
+    uint32_t prdeadline;    // Deadline relative to each release
+    uint32_t prrelease;     // Release time of the next job
+    uint32_t prabsdeadline; // Deadline of the current job
+    uint32_t prbudgetleft;  // CPU time left in the current job
+    int prmisses;           // Deadlines missed so far
+    int prrtnext;           // Next in the EDF ready queue
+    int prrtprev;           // Previous in the EDF ready queue
+    int prrelnext;          // Next in the release queue (by prrelease)
+    int prrelprev;          // Previous in the release queue
+    int prdlnext;           // Next unfinished job (by prabsdeadline)
+    int prdlprev;           // Previous unfinished job
+
+    // Sleep queue (delta list)
+    int prsleepnext;        // Next sleeper
+    uint32_t prdelta;       // Ticks after the previous sleeper wakes
+
+    // FPU/SSE state (lazy, see fpu.h)
+    uint8_t *prfpu;         // FXSAVE area, NULL until the first FPU use
+    int prfpucpu;           // CPU whose registers last held prfpu
+
     // IPC (Inter-Process Communication)
     Message msg_inbox;      // Latest message received
     int has_msg;            // 1 if message available, 0 otherwise
     pid32 sender_pid;       // Last sender PID
-} pcb_t;
+} pcb_cold_t;
 
 // Queue structure
 typedef struct queue
 {
     int head;        // Front of queue (slot index)
     int tail;        // Back of queue (slot index)
+    int count;       // Entries, kept up to date by q_insert/q_delete
 } queue_t;
 
-// Process table
-extern pcb_t proctab[NPROC];
+// Process table: slots 0..proctab_slots-1 are allocated, and a PCB
+// never moves once allocated. proccold[slot] is the cold half of
+// proctab[slot].
+extern pcb_t *proctab[NPROC_MAX];
+extern pcb_cold_t *proccold[NPROC_MAX];
+extern volatile int proctab_slots;
+
+// Process currently running on this CPU
+#define currpid (cpu_self()->cpu_currpid)
+
+// Protects proctab, the ready queues and each CPU's currpid
+extern spinlock_t proc_lock;
 
-// Process currently running
-extern pid32 currpid;
+// Use the pre-carved stack pool for new processes (1 by default)
+extern int proc_use_stack_pool;
 
-// Ready queue (exposed for scheduler)
-extern queue_t readylist;
+// Report peak stack use as each process is released (0 by default;
+// a stack used down to its base is always reported)
+extern int proc_report_stacks;
 
 // Functions - Process Management
 void init_proctab(void);
 pid32 create_process(int priority);
 pid32 create_process_with_func(int priority, void (*func)(void));
+pid32 create_process_with_stack(int priority, void (*func)(void), size_t stack_size);
+pid32 create_process_pinned(int priority, void (*func)(void));
 int terminate_process(pid32 pid);
 void set_current(pid32 pid);
 pid32 get_next_ready(void);
 void enqueue_ready(int slot);
 void dequeue_process(int slot);
+void proc_release(int slot);
 
 // Functions - Queue Operations
 void q_insert(int slot, queue_t *q);
 int q_remove(queue_t *q);
+void q_delete(int slot, queue_t *q);
 int q_empty(queue_t *q);
 
 // Functions - Utility/Accessor
@@ -87,6 +183,9 @@ int get_process_state(pid32 pid);
 int get_process_priority(pid32 pid);
 int is_valid_pid(pid32 pid);
 char* get_stack_base(pid32 pid);
+size_t get_stack_size(pid32 pid);
+size_t get_stack_peak(pid32 pid);
+void print_stacks(void);
 int get_num_ready(void);
 
 // Functions - IPC (Inter-Process Communication)
@@ -2,6 +2,12 @@
 #include "scheduler.h"
 #include "process.h"
 #include "serial.h"
+#include "cpu.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "timer.h"
+#include "trace.h"
+#include "fpu.h"
 
 /* Current scheduling policy */
 int sched_policy = SCHED_PRIO;  // Default: Priority-based Round-Robin
@@ -12,18 +18,767 @@ extern void ctxsw(void** old_sp, void** new_sp);
 /* Scheduler Functions */
 void sched_init(void);
 void resched(void);
+static void resched_for(int reason);
 void yield(void);
 pid32 schedule_next(void);
 
+/* Per-CPU run queue. Everything here is protected by proc_lock. */
+typedef struct runq {
+    /* Per-priority ready queues; bit p of prio_bitmap is set while queue
+     * p is non-empty, so the highest ready priority is a single bsr */
+    queue_t prioq[NPRIO];
+    uint32_t prio_bitmap;
+
+    /* MLFQ level queues, kept alongside prioq so that sched_policy can
+     * be switched at any time; bit l of mlfq_bitmap is set while level
+     * l is non-empty */
+    queue_t mlfq[MLFQ_LEVELS];
+    uint32_t mlfq_bitmap;
+
+    int nready;         /* Processes queued here */
+
+    /* The same processes in arrival order (next/prev), for SCHED_RR */
+    queue_t arrivals;
+
+    /* Stride: the same processes as a binary min-heap on prpass, so the
+     * lowest pass is strideq[0]; strideq[0..nready-1] are in use */
+    int strideq[NPROC_MAX];
+
+    /* Ready real-time processes, earliest deadline first (prrtnext) */
+    int rtq;
+
+    /* Scheduler context (sched_run() on CPU 0, sched_idle() on the
+     * others) while this CPU is executing processes */
+    void *return_sp;
+    int running;
+
+    uint32_t pass;      /* Stride: pass of the last process dispatched here */
+
+    void *dead_sp;      /* Save slot for the context of a dead process */
+    int zombie;         /* Exited here, released after the switch (-1 = none) */
+} runq_t;
+
+static runq_t runqs[MAX_CPUS];
+
+static uint32_t mlfq_boost_clock = 0;
+
+/* Aging clock, advanced once per yield. A ready process has waited
+ * aging_clock - prready_since; its boost is computed from that only
+ * when the scheduler looks at it, instead of by scanning the table. */
+static uint32_t aging_clock = 0;
+
+/* Sleeping processes in wake-up order; each prdelta counts the ticks
+ * after the one before it, so only the head is ever decremented */
+static int sleepq = -1;
+
+/* Admitted real-time density (RT_UTIL_ONE = 100%) and missed deadlines */
+static uint32_t rt_util = 0;
+static int rt_misses = 0;
+
+/* Admitted real-time processes by next release (prrelnext), and jobs
+ * not yet completed by deadline (prdlnext), so CPU 0's tick only looks
+ * at the heads */
+static int rt_relq = -1;
+static int rt_dlq = -1;
+
+static inline runq_t *this_rq(void)
+{
+    return &runqs[cpu_self()->id];
+}
+
+static int prio_level(int prio)
+{
+    if (prio < 0)
+        return 0;
+    if (prio >= NPRIO)
+        return NPRIO - 1;
+    return prio;
+}
+
+/* Tick comparison that survives timer_ticks wrapping around */
+static inline int tick_before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+/* Queue a real-time process behind every earlier or equal deadline */
+static void rt_insert(runq_t *rq, int slot)
+{
+    int prev = -1, next = rq->rtq;
+
+    while (next != -1 &&
+           !tick_before(proccold[slot]->prabsdeadline, proccold[next]->prabsdeadline)) {
+        prev = next;
+        next = proccold[next]->prrtnext;
+    }
+
+    proccold[slot]->prrtprev = prev;
+    proccold[slot]->prrtnext = next;
+    if (prev == -1)
+        rq->rtq = slot;
+    else
+        proccold[prev]->prrtnext = slot;
+    if (next != -1)
+        proccold[next]->prrtprev = slot;
+}
+
+static void rt_remove(runq_t *rq, int slot)
+{
+    if (proccold[slot]->prrtprev == -1)
+        rq->rtq = proccold[slot]->prrtnext;
+    else
+        proccold[proccold[slot]->prrtprev]->prrtnext = proccold[slot]->prrtnext;
+    if (proccold[slot]->prrtnext != -1)
+        proccold[proccold[slot]->prrtnext]->prrtprev = proccold[slot]->prrtprev;
+
+    proccold[slot]->prrtnext = -1;
+    proccold[slot]->prrtprev = -1;
+}
+
+/* Stride heap order: lower pass first, wrap-safe like tick_before */
+static inline int pass_before(int a, int b)
+{
+    return (int32_t)(proctab[a]->prpass - proctab[b]->prpass) < 0;
+}
+
+static inline void stride_put(runq_t *rq, int pos, int slot)
+{
+    rq->strideq[pos] = slot;
+    proctab[slot]->prheappos = pos;
+}
+
+static void stride_sift_up(runq_t *rq, int pos)
+{
+    int slot = rq->strideq[pos];
+
+    while (pos > 0 && pass_before(slot, rq->strideq[(pos - 1) / 2])) {
+        stride_put(rq, pos, rq->strideq[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    stride_put(rq, pos, slot);
+}
+
+static void stride_sift_down(runq_t *rq, int pos, int n)
+{
+    int slot = rq->strideq[pos];
+    int child;
+
+    while ((child = 2 * pos + 1) < n) {
+        if (child + 1 < n && pass_before(rq->strideq[child + 1], rq->strideq[child]))
+            child++;
+        if (!pass_before(rq->strideq[child], slot))
+            break;
+        stride_put(rq, pos, rq->strideq[child]);
+        pos = child;
+    }
+    stride_put(rq, pos, slot);
+}
+
+/* Add a process to the stride heap of rq (before nready counts it) */
+static void stride_insert(runq_t *rq, int slot)
+{
+    stride_put(rq, rq->nready, slot);
+    stride_sift_up(rq, rq->nready);
+}
+
+/* Take a process out of the stride heap of rq (nready still counts it) */
+static void stride_remove(runq_t *rq, int slot)
+{
+    int pos = proctab[slot]->prheappos;
+    int last = rq->nready - 1;
+    int moved = rq->strideq[last];
+
+    proctab[slot]->prheappos = -1;
+    if (pos == last)
+        return;
+    stride_put(rq, pos, moved);
+    stride_sift_up(rq, pos);
+    stride_sift_down(rq, proctab[moved]->prheappos, last);
+}
+
+/* Append a process to the MLFQ queue of its level */
+static void mlfq_link(runq_t *rq, int slot)
+{
+    int level = proctab[slot]->prmlevel;
+    queue_t *q = &rq->mlfq[level];
+
+    proctab[slot]->prmqnext = -1;
+    proctab[slot]->prmqprev = q->tail;
+    if (q->tail == -1)
+        q->head = slot;
+    else
+        proctab[q->tail]->prmqnext = slot;
+    q->tail = slot;
+
+    rq->mlfq_bitmap |= (1u << level);
+}
+
+static void mlfq_unlink(runq_t *rq, int slot)
+{
+    int level = proctab[slot]->prmlevel;
+    queue_t *q = &rq->mlfq[level];
+
+    if (proctab[slot]->prmqprev == -1)
+        q->head = proctab[slot]->prmqnext;
+    else
+        proctab[proctab[slot]->prmqprev]->prmqnext = proctab[slot]->prmqnext;
+    if (proctab[slot]->prmqnext == -1)
+        q->tail = proctab[slot]->prmqprev;
+    else
+        proctab[proctab[slot]->prmqnext]->prmqprev = proctab[slot]->prmqprev;
+
+    if (q->head == -1)
+        rq->mlfq_bitmap &= ~(1u << level);
+
+    proctab[slot]->prmqnext = -1;
+    proctab[slot]->prmqprev = -1;
+}
+
+/* Queue a ready process that has been waiting since 'since'. A priority
+ * queue stays ordered by prready_since, so its head has waited longest:
+ * a new arrival is appended in O(1), and only a process carried over
+ * from another CPU may have to go further forward. Plus O(log n) for
+ * the stride heap. */
+static void ready_insert(int slot, uint32_t since)
+{
+    int level, prev, next;
+    queue_t *q;
+    runq_t *rq;
+
+    if (slot < 0 || slot >= proctab_slots || proctab[slot]->prqlevel != -1)
+        return;
+
+    rq = &runqs[proctab[slot]->prcpu];
+    level = prio_level(proctab[slot]->prprio);
+    q = &rq->prioq[level];
+
+    /* Stride: a newcomer starts level with the CPU, not at zero */
+    if ((int32_t)(proctab[slot]->prpass - rq->pass) < 0)
+        proctab[slot]->prpass = rq->pass;
+
+    proctab[slot]->prready_since = since;
+    next = -1;
+    prev = q->tail;
+    while (prev != -1 && tick_before(since, proctab[prev]->prready_since)) {
+        next = prev;
+        prev = proctab[prev]->prqprev;
+    }
+
+    proctab[slot]->prqnext = next;
+    proctab[slot]->prqprev = prev;
+    if (prev == -1)
+        q->head = slot;
+    else
+        proctab[prev]->prqnext = slot;
+    if (next == -1)
+        q->tail = slot;
+    else
+        proctab[next]->prqprev = slot;
+
+    proctab[slot]->prqlevel = level;
+    rq->prio_bitmap |= (1u << level);
+
+    mlfq_link(rq, slot);
+    q_insert(slot, &rq->arrivals);
+
+    if (proctab[slot]->prrt)
+        rt_insert(rq, slot);
+    stride_insert(rq, slot);
+    rq->nready++;
+}
+
+/* Append a ready process to the queue of its priority - O(1), plus
+ * O(log n) for the stride heap */
+void sched_ready_insert(int slot)
+{
+    ready_insert(slot, aging_clock);
+}
+
+/* Unlink a process from its priority queue - O(1), plus O(log n) for
+ * the stride heap */
+void sched_ready_remove(int slot)
+{
+    int level;
+    queue_t *q;
+    runq_t *rq;
+
+    if (slot < 0 || slot >= proctab_slots || proctab[slot]->prqlevel == -1)
+        return;
+
+    rq = &runqs[proctab[slot]->prcpu];
+    level = proctab[slot]->prqlevel;
+    q = &rq->prioq[level];
+
+    if (proctab[slot]->prqprev == -1)
+        q->head = proctab[slot]->prqnext;
+    else
+        proctab[proctab[slot]->prqprev]->prqnext = proctab[slot]->prqnext;
+    if (proctab[slot]->prqnext == -1)
+        q->tail = proctab[slot]->prqprev;
+    else
+        proctab[proctab[slot]->prqnext]->prqprev = proctab[slot]->prqprev;
+
+    if (q->head == -1)
+        rq->prio_bitmap &= ~(1u << level);
+
+    proctab[slot]->prqnext = -1;
+    proctab[slot]->prqprev = -1;
+    proctab[slot]->prqlevel = -1;
+
+    mlfq_unlink(rq, slot);
+    q_delete(slot, &rq->arrivals);
+
+    if (proctab[slot]->prrt)
+        rt_remove(rq, slot);
+    stride_remove(rq, slot);
+    rq->nready--;
+}
+
+/* Oldest ready process queued on a CPU, -1 if none */
+int sched_ready_head(int cpu)
+{
+    return runqs[cpu].arrivals.head;
+}
+
+/* Ready processes over all CPUs */
+int sched_ready_count(void)
+{
+    int c, n = 0;
+
+    for (c = 0; c < MAX_CPUS; c++)
+        n += runqs[c].nready;
+    return n;
+}
+
+/* Change the MLFQ level and/or CPU of a process. A ready process that
+ * stays on its CPU only moves between MLFQ queues and keeps its place
+ * in the others; one that changes CPU is queued there by how long it
+ * has already waited. */
+static void requeue(int slot, int level, int cpu)
+{
+    int queued = (proctab[slot]->prqlevel != -1);
+    uint32_t since = proctab[slot]->prready_since;
+
+    if (cpu == proctab[slot]->prcpu) {
+        if (queued)
+            mlfq_unlink(&runqs[cpu], slot);
+        proctab[slot]->prmlevel = level;
+        if (queued)
+            mlfq_link(&runqs[cpu], slot);
+        return;
+    }
+
+    if (queued)
+        sched_ready_remove(slot);
+    proctab[slot]->prmlevel = level;
+    /* Keep the stride lag relative to the new CPU's virtual time */
+    proctab[slot]->prpass += runqs[cpu].pass - runqs[proctab[slot]->prcpu].pass;
+    proctab[slot]->prcpu = cpu;
+    if (queued)
+        ready_insert(slot, since);
+}
+
+/* Move a process to another MLFQ level, with a full allotment there */
+static void mlfq_set_level(int slot, int level)
+{
+    if (level < 0)
+        level = 0;
+    if (level >= MLFQ_LEVELS)
+        level = MLFQ_LEVELS - 1;
+    proctab[slot]->prmallot = MLFQ_ALLOTMENT(level);
+    if (level != proctab[slot]->prmlevel)
+        requeue(slot, level, proctab[slot]->prcpu);
+}
+
+/* MLFQ: a process that yields or blocks before its slice is over moves
+ * up a level, with a full allotment there */
+static void mlfq_release_early(int slot)
+{
+    if (sched_policy == SCHED_MLFQ && proctab[slot]->prtime > 0 &&
+        proctab[slot]->prmlevel > 0)
+        mlfq_set_level(slot, proctab[slot]->prmlevel - 1);
+}
+
+/* Priority after aging: +AGING_BOOST per AGING_THRESHOLD spent ready,
+ * until AGING_PRIO_CAP is reached */
+static int effective_prio(int slot)
+{
+    int prio = proctab[slot]->prprio;
+    uint32_t boosts, needed;
+
+    if (proctab[slot]->prstate != PR_READY || prio >= AGING_PRIO_CAP)
+        return prio;
+
+    boosts = (aging_clock - proctab[slot]->prready_since) / AGING_THRESHOLD;
+    needed = (AGING_PRIO_CAP - prio + AGING_BOOST - 1) / AGING_BOOST;
+    if (boosts > needed)
+        boosts = needed;
+    return prio + boosts * AGING_BOOST;
+}
+
+/* Periodic reset: everything back to the top level */
+static void mlfq_boost(void)
+{
+    int i;
+
+    for (i = 0; i < proctab_slots; i++) {
+        if (proctab[i]->prstate != PR_FREE)
+            mlfq_set_level(i, 0);
+    }
+}
+
+/* Density of a real-time process in RT_UTIL_ONE units, rounded up */
+static uint32_t rt_density(int slot)
+{
+    return (proccold[slot]->prbudget * RT_UTIL_ONE + proccold[slot]->prdeadline - 1) /
+           proccold[slot]->prdeadline;
+}
+
+/* Release queue (dl = 0) or deadline queue (dl = 1) links and key */
+static int *rt_next(int slot, int dl)
+{
+    return dl ? &proccold[slot]->prdlnext : &proccold[slot]->prrelnext;
+}
+
+static int *rt_prev(int slot, int dl)
+{
+    return dl ? &proccold[slot]->prdlprev : &proccold[slot]->prrelprev;
+}
+
+static uint32_t rt_key(int slot, int dl)
+{
+    return dl ? proccold[slot]->prabsdeadline : proccold[slot]->prrelease;
+}
+
+/* Queue behind every earlier or equal time */
+static void rt_list_insert(int *head, int slot, int dl)
+{
+    int prev = -1, next = *head;
+
+    while (next != -1 && !tick_before(rt_key(slot, dl), rt_key(next, dl))) {
+        prev = next;
+        next = *rt_next(next, dl);
+    }
+
+    *rt_prev(slot, dl) = prev;
+    *rt_next(slot, dl) = next;
+    if (prev == -1)
+        *head = slot;
+    else
+        *rt_next(prev, dl) = slot;
+    if (next != -1)
+        *rt_prev(next, dl) = slot;
+}
+
+/* Unlink, if queued */
+static void rt_list_remove(int *head, int slot, int dl)
+{
+    int prev = *rt_prev(slot, dl), next = *rt_next(slot, dl);
+
+    if (prev == -1 && *head != slot)
+        return;
+    if (prev == -1)
+        *head = next;
+    else
+        *rt_next(prev, dl) = next;
+    if (next != -1)
+        *rt_prev(next, dl) = prev;
+
+    *rt_prev(slot, dl) = -1;
+    *rt_next(slot, dl) = -1;
+}
+
+/* Start the job released at 'release' (proc_lock held) */
+static void rt_new_job(int slot, uint32_t release)
+{
+    rt_list_remove(&rt_relq, slot, 0);
+    rt_list_remove(&rt_dlq, slot, 1);
+
+    proccold[slot]->prabsdeadline = release + proccold[slot]->prdeadline;
+    proccold[slot]->prrelease = release + proccold[slot]->prperiod;
+    proccold[slot]->prbudgetleft = proccold[slot]->prbudget;
+
+    rt_list_insert(&rt_relq, slot, 0);
+    rt_list_insert(&rt_dlq, slot, 1);
+}
+
+/* CPU 0's tick: count deadlines passed by unfinished jobs and release
+ * the jobs that are due - O(1) per tick plus the jobs concerned */
+static void rt_tick(uint32_t now)
+{
+    int i;
+
+    while (rt_dlq != -1 && !tick_before(now, proccold[rt_dlq]->prabsdeadline)) {
+        i = rt_dlq;
+        rt_list_remove(&rt_dlq, i, 1);
+        if (proctab[i]->prstate == PR_DEAD)
+            continue;
+        proccold[i]->prmisses++;
+        rt_misses++;
+    }
+
+    while (rt_relq != -1 && !tick_before(now, proccold[rt_relq]->prrelease)) {
+        i = rt_relq;
+        if (proctab[i]->prstate == PR_DEAD) {
+            rt_list_remove(&rt_relq, i, 0);
+            continue;
+        }
+
+        if (proctab[i]->prstate == PR_READY) {
+            /* Still waiting from the last period: requeue by the new deadline */
+            rt_remove(&runqs[proctab[i]->prcpu], i);
+            rt_new_job(i, proccold[i]->prrelease);
+            rt_insert(&runqs[proctab[i]->prcpu], i);
+        } else {
+            rt_new_job(i, proccold[i]->prrelease);
+            if (proctab[i]->prstate == PR_WAITING)
+                enqueue_ready(i);
+            else
+                proctab[i]->prtime = proccold[i]->prbudgetleft;
+        }
+    }
+}
+
+/* Queue a process to wake 'ticks' ticks from now (proc_lock held) */
+static void sleep_insert(int slot, uint32_t ticks)
+{
+    int prev = -1, next = sleepq;
+
+    /* Behind everyone due at the same tick or earlier */
+    while (next != -1 && proccold[next]->prdelta <= ticks) {
+        ticks -= proccold[next]->prdelta;
+        prev = next;
+        next = proccold[next]->prsleepnext;
+    }
+
+    proccold[slot]->prdelta = ticks;
+    proccold[slot]->prsleepnext = next;
+    if (next != -1)
+        proccold[next]->prdelta -= ticks;
+    if (prev == -1)
+        sleepq = slot;
+    else
+        proccold[prev]->prsleepnext = slot;
+}
+
+/* Unlink a sleeper; its remaining delta goes to the one behind it */
+void sched_sleep_remove(int slot)
+{
+    int prev = -1, cur = sleepq;
+
+    while (cur != -1 && cur != slot) {
+        prev = cur;
+        cur = proccold[cur]->prsleepnext;
+    }
+    if (cur == -1)
+        return;
+
+    if (proccold[slot]->prsleepnext != -1)
+        proccold[proccold[slot]->prsleepnext]->prdelta += proccold[slot]->prdelta;
+    if (prev == -1)
+        sleepq = proccold[slot]->prsleepnext;
+    else
+        proccold[prev]->prsleepnext = proccold[slot]->prsleepnext;
+    proccold[slot]->prsleepnext = -1;
+}
+
+/* One tick off the head sleeper; wake everyone now due - O(1) per tick
+ * plus the processes woken */
+static void sleep_tick(void)
+{
+    if (proccold[sleepq]->prdelta > 0)
+        proccold[sleepq]->prdelta--;
+
+    while (sleepq != -1 && proccold[sleepq]->prdelta == 0) {
+        int slot = sleepq;
+
+        sleepq = proccold[slot]->prsleepnext;
+        proccold[slot]->prsleepnext = -1;
+        enqueue_ready(slot);
+    }
+}
+
+/* Ticks a process may run once dispatched */
+static int time_slice(int slot)
+{
+    if (proctab[slot]->prrt)
+        return proccold[slot]->prbudgetleft;
+    if (sched_policy == SCHED_MLFQ)
+        return MLFQ_BASE_QUANTUM << proctab[slot]->prmlevel;
+    if (sched_policy == SCHED_STRIDE)
+        return STRIDE_QUANTUM;
+    return proctab[slot]->prquantum;
+}
+
+/* Slot of the process the current policy would run next from one
+ * CPU's run queue, -1 if none. Real-time processes come first. */
+static int pick_next_slot(runq_t *rq)
+{
+    if (rq->rtq != -1)
+        return rq->rtq;             /* EDF: earliest deadline */
+
+    if (sched_policy == SCHED_RR)
+        return rq->arrivals.head;   /* Round-Robin: first to arrive here */
+
+    if (sched_policy == SCHED_PRIO) {
+        /* Priority-based with aging. Each queue is FIFO, so its head has
+         * waited longest and is the only candidate from that level. */
+        uint32_t map = rq->prio_bitmap;
+        int best = -1, best_prio = -1;
+
+        while (map) {
+            int level = bsr(map);
+            int slot = rq->prioq[level].head;
+            int prio;
+
+            /* Below the cap nothing can age past AGING_PRIO_CAP - 1 + AGING_BOOST */
+            if (level < AGING_PRIO_CAP && best_prio >= AGING_PRIO_CAP - 1 + AGING_BOOST)
+                break;
+
+            prio = effective_prio(slot);
+            if (prio > best_prio) {
+                best = slot;
+                best_prio = prio;
+            }
+            map &= ~(1u << level);
+        }
+        return best;
+    }
+
+    if (sched_policy == SCHED_MLFQ) {
+        /* MLFQ: head of the topmost non-empty level */
+        if (!rq->mlfq_bitmap)
+            return -1;
+        return rq->mlfq[bsf(rq->mlfq_bitmap)].head;
+    }
+
+    if (sched_policy == SCHED_STRIDE) {
+        /* Stride: lowest pass among the ready processes of this CPU */
+        return rq->nready ? rq->strideq[0] : -1;
+    }
+
+    return -1;
+}
+
+/* Does the running process keep the CPU although next_slot is ready?
+ * 'reason' is why the scheduler was entered (TRACE_*). */
+static int keeps_cpu(int old_slot, int next_slot, int reason)
+{
+    /* Real-time: only an earlier deadline preempts */
+    if (proctab[old_slot]->prrt)
+        return !proctab[next_slot]->prrt ||
+               !tick_before(proccold[next_slot]->prabsdeadline, proccold[old_slot]->prabsdeadline);
+    if (proctab[next_slot]->prrt)
+        return 0;
+
+    /* MLFQ: a process on a higher level than everything ready keeps going */
+    if (sched_policy == SCHED_MLFQ)
+        return proctab[old_slot]->prmlevel < proctab[next_slot]->prmlevel;
+
+    /* Stride: the running process keeps going while it is still behind,
+     * unless it is yielding; its low pass gets it picked again soon */
+    if (sched_policy == SCHED_STRIDE && reason != TRACE_YIELD)
+        return (int32_t)(proctab[old_slot]->prpass - proctab[next_slot]->prpass) <= 0;
+
+    return 0;
+}
+
+/* Least-loaded online CPU, where a new process is queued */
+int sched_home_cpu(void)
+{
+    int c, load, best = 0, best_load = -1;
+
+    for (c = 0; c < MAX_CPUS; c++) {
+        if (!cpus[c].online)
+            continue;
+        load = runqs[c].nready + (cpus[c].cpu_currpid != -1);
+        if (best_load == -1 || load < best_load) {
+            best = c;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+/* Processes without an entry point, and pinned ones, never migrate */
+static int can_migrate(int slot)
+{
+    return proctab[slot]->prfunc != NULL && !proctab[slot]->prpinned;
+}
+
+/* Work stealing: take the best ready process of the CPU with the most
+ * waiting work, or failing that its oldest one that may migrate. A CPU
+ * holding only processes that can't move is passed over for the next
+ * busiest. */
+static int steal_slot(int self)
+{
+    int c, slot, victim, most;
+    uint32_t tried = 1u << self;
+
+    for (;;) {
+        victim = -1;
+        most = 0;
+        for (c = 0; c < MAX_CPUS; c++) {
+            if (!(tried & (1u << c)) && cpus[c].online && runqs[c].nready > most) {
+                victim = c;
+                most = runqs[c].nready;
+            }
+        }
+        if (victim == -1)
+            return -1;
+        tried |= 1u << victim;
+
+        slot = pick_next_slot(&runqs[victim]);
+        if (slot == -1 || !can_migrate(slot)) {
+            slot = runqs[victim].arrivals.head;
+            while (slot != -1 && !can_migrate(slot))
+                slot = proctab[slot]->next;
+        }
+        if (slot != -1) {
+            requeue(slot, proctab[slot]->prmlevel, self);
+            return slot;
+        }
+    }
+}
+
+/* Runs on the new context right after every switch: release a process
+ * that exited on this CPU now that nothing runs on its stack */
+static void finish_switch(void)
+{
+    runq_t *rq = this_rq();
+
+    if (rq->zombie != -1) {
+        proc_release(rq->zombie);
+        rq->zombie = -1;
+    }
+}
+
+/* First C code of a new process, from proc_start (ctxsw.S). The
+ * process was switched to with proc_lock held. */
+void sched_proc_entry(void)
+{
+    finish_switch();
+    spin_unlock(&proc_lock);
+}
+
 /* Process exit handler - called when process function returns */
 void user_process_exit(void)
 {
-    if (currpid != -1) {
-        terminate_process(currpid);
+    int slot;
+
+    /* Interrupts stay off until the next process restores its own */
+    spin_lock_irqsave(&proc_lock);
+
+    slot = find_slot(currpid);
+    if (slot != -1) {
+        /* Still on this process's stack: release it after the switch */
+        proctab[slot]->prstate = PR_DEAD;
+        this_rq()->zombie = slot;
     }
+    currpid = -1;
     
     /* Reschedule to next process */
-    resched();
+    resched_for(TRACE_EXIT);
     
     /* Should never reach here */
     while(1);
@@ -32,117 +787,362 @@ void user_process_exit(void)
 /* Initialize scheduler */
 void sched_init(void)
 {
+    int c, i;
+
+    for (c = 0; c < MAX_CPUS; c++) {
+        runq_t *rq = &runqs[c];
+
+        for (i = 0; i < NPRIO; i++) {
+            rq->prioq[i].head = -1;
+            rq->prioq[i].tail = -1;
+        }
+        rq->prio_bitmap = 0;
+
+        for (i = 0; i < MLFQ_LEVELS; i++) {
+            rq->mlfq[i].head = -1;
+            rq->mlfq[i].tail = -1;
+        }
+        rq->mlfq_bitmap = 0;
+
+        rq->nready = 0;
+        rq->arrivals.head = -1;
+        rq->arrivals.tail = -1;
+        rq->arrivals.count = 0;
+        rq->rtq = -1;
+        rq->pass = 0;
+        rq->return_sp = NULL;
+        rq->running = 0;
+        rq->dead_sp = NULL;
+        rq->zombie = -1;
+    }
+    mlfq_boost_clock = 0;
+    aging_clock = 0;
+    sleepq = -1;
+    rt_util = 0;
+    rt_misses = 0;
+    rt_relq = -1;
+    rt_dlq = -1;
+
     sched_policy = SCHED_PRIO;
     serial_puts("[Scheduler] Initialized with Priority-based Round-Robin policy\n");
 }
 
-/* Main scheduler - select and switch to next process */
-void resched(void)
+/* Main scheduler - select and switch to next process, 'reason' being
+ * what the trace records (TRACE_*).
+ * Must be called with proc_lock held and interrupts disabled; the lock
+ * is handed over to whichever context runs next on this CPU. */
+static void resched_for(int reason)
 {
+    runq_t *rq = this_rq();
     pid32 old_pid = currpid;
     pid32 next_pid;
     int old_slot, next_slot;
+    int old_runs;
+    void **old_sp;
+    pid32 traced_pid;
+
+    old_slot = find_slot(old_pid);
+    old_runs = (old_slot != -1 && proctab[old_slot]->prstate == PR_CURR);
 
-    /* Get next process to run */
-    next_pid = schedule_next();
+    /* An exiting process has already given up currpid */
+    traced_pid = (old_pid == -1 && rq->zombie != -1) ? proctab[rq->zombie]->pid : old_pid;
+
+    /* Get next process to run; an otherwise idle CPU steals one */
+    next_slot = pick_next_slot(rq);
+    if (next_slot == -1 && !old_runs && rq->running)
+        next_slot = steal_slot(cpu_self()->id);
     
-    if (next_pid == -1) {
+    if (next_slot == -1) {
+        /* Nothing else ready: a running process just keeps the CPU */
+        if (old_runs) {
+            trace_switch(reason, old_pid, old_pid, rq->nready);
+            proctab[old_slot]->prtime = time_slice(old_slot);
+            return;
+        }
+
+        /* Last process is gone - hand the CPU back to the scheduler loop */
+        if (rq->running) {
+            trace_switch(reason, traced_pid, -1, rq->nready);
+            fpu_switch_out(old_slot);
+            currpid = -1;
+            rq->running = 0;
+            ctxsw(old_slot != -1 ? (void**)&proctab[old_slot]->prstkptr : &rq->dead_sp,
+                  &rq->return_sp);
+            finish_switch();
+            return;
+        }
+
         /* No process to run - should not happen in well-designed system */
         serial_puts("[Scheduler] WARNING: No process ready to run!\n");
         return;
     }
+    next_pid = proctab[next_slot]->pid;
+
+    /* Policy-specific reasons for the running process to stay */
+    if (old_runs && keeps_cpu(old_slot, next_slot, reason)) {
+        trace_switch(reason, old_pid, old_pid, rq->nready);
+        proctab[old_slot]->prtime = time_slice(old_slot);
+        return;
+    }
 
     /* If same process, no need to switch */
     if (next_pid == old_pid) {
         return;
     }
 
-    old_slot = find_slot(old_pid);
-    next_slot = find_slot(next_pid);
+    trace_switch(reason, traced_pid, next_pid, rq->nready);
 
     /* Move current process back to ready (if it was running) */
-    if (old_pid != -1 && old_slot != -1) {
-        if (proctab[old_slot].prstate == PR_CURR) {
-            proctab[old_slot].prstate = PR_READY;
-            enqueue_ready(old_slot);
-        }
+    if (old_runs) {
+        proctab[old_slot]->prstate = PR_READY;
+        enqueue_ready(old_slot);
     }
 
     /* Remove next process from ready queue and mark as current */
     dequeue_process(next_slot);
-    proctab[next_slot].prstate = PR_CURR;
+    proctab[next_slot]->prstate = PR_CURR;
+    proctab[next_slot]->prcpu = cpu_self()->id;
+    rq->pass = proctab[next_slot]->prpass;
     
     /* Reset quantum for new process */
-    proctab[next_slot].prtime = proctab[next_slot].prquantum;
+    proctab[next_slot]->prtime = time_slice(next_slot);
     
     currpid = next_pid;
 
-    /* Perform context switch if we had a previous process */
-    if (old_pid != -1 && old_slot != -1) {
-        ctxsw((void**)&proctab[old_slot].prstkptr, 
-              (void**)&proctab[next_slot].prstkptr);
+    /* Outside the scheduler loop the caller is kmain, which is not a
+     * process: only the bookkeeping above is done, there is nothing to
+     * switch from */
+    if (!rq->running)
+        return;
+
+    /* A terminated process's context is saved nowhere useful */
+    old_sp = (old_slot != -1) ? (void**)&proctab[old_slot]->prstkptr : &rq->dead_sp;
+    fpu_switch_out(old_slot);
+    ctxsw(old_sp, (void**)&proctab[next_slot]->prstkptr);
+
+    /* Possibly resumed on another CPU */
+    finish_switch();
+}
+
+void resched(void)
+{
+    resched_for(TRACE_CALL);
+}
+
+/* Switch from this CPU's scheduler loop to the next ready process
+ * (local or stolen); returns 0 if there was none. proc_lock held. */
+static int run_next(void)
+{
+    runq_t *rq = this_rq();
+    int self = cpu_self()->id;
+    int slot;
+
+    if (rq->running)
+        return 0;
+
+    slot = pick_next_slot(rq);
+    if (slot == -1)
+        slot = steal_slot(self);
+    if (slot == -1)
+        return 0;
+
+    trace_switch(TRACE_IDLE, -1, proctab[slot]->pid, rq->nready);
+    dequeue_process(slot);
+    proctab[slot]->prstate = PR_CURR;
+    proctab[slot]->prcpu = self;
+    proctab[slot]->prtime = time_slice(slot);
+    rq->pass = proctab[slot]->prpass;
+    currpid = proctab[slot]->pid;
+    rq->running = 1;
+
+    fpu_switch_out(-1);
+    ctxsw(&rq->return_sp, (void**)&proctab[slot]->prstkptr);
+    finish_switch();
+    return 1;
+}
+
+/* Any runnable process left on any CPU? */
+static int work_pending(void)
+{
+    int i;
+
+    for (i = 0; i < proctab_slots; i++) {
+        int state = proctab[i]->prstate;
+        if (proctab[i]->prfunc != NULL &&
+            (state == PR_READY || state == PR_CURR || state == PR_DEAD))
+            return 1;
+        /* A real-time process between jobs will be released again */
+        if (proctab[i]->prrt && state == PR_WAITING)
+            return 1;
+        if (state == PR_SLEEP)
+            return 1;
     }
+    return 0;
+}
+
+/* Wait for an interrupt with proc_lock dropped */
+static void idle_wait(void)
+{
+    spin_unlock(&proc_lock);
+    __asm__ volatile ("sti; hlt; cli");
+    spin_lock(&proc_lock);
+}
+
+/* Run ready processes from kernel context until none is left on any
+ * CPU, then return to the caller (the shell / null process) */
+void sched_run(void)
+{
+    uint32_t mask;
+
+    mask = spin_lock_irqsave(&proc_lock);
+
+    while (!this_rq()->running) {
+        if (run_next())
+            continue;
+        if (!work_pending())
+            break;
+        idle_wait();    /* Other CPUs are still busy */
+    }
+
+    spin_unlock_irqrestore(&proc_lock, mask);
+}
+
+/* Idle loop of an application processor: run whatever is ready here or
+ * can be stolen, sleep until the next tick otherwise */
+void sched_idle(void)
+{
+    spin_lock_irqsave(&proc_lock);
+
+    for (;;) {
+        if (!run_next())
+            idle_wait();
+    }
+}
+
+/* Timer tick (interrupt context): charge the running process and
+ * preempt it once its quantum is used up */
+void sched_tick(void)
+{
+    int slot;
+
+    spin_lock(&proc_lock);
+
+    /* One boost clock for the system, driven by CPU 0's tick */
+    if (sched_policy == SCHED_MLFQ && cpu_self()->id == 0 &&
+        ++mlfq_boost_clock >= MLFQ_BOOST_TICKS) {
+        mlfq_boost_clock = 0;
+        mlfq_boost();
+    }
+
+    /* Sleepers, also by CPU 0's tick */
+    if (sleepq != -1 && cpu_self()->id == 0)
+        sleep_tick();
+
+    /* Real-time releases and deadlines, also by CPU 0's tick */
+    if (rt_util != 0 && cpu_self()->id == 0)
+        rt_tick(timer_ticks);
+
+    slot = find_slot(currpid);
+    if (currpid == -1 || slot == -1 || !this_rq()->running) {
+        spin_unlock(&proc_lock);
+        return;
+    }
+
+    update_process_time();
+
+    /* MLFQ: the tick comes out of this level's allotment; once it is used
+     * up, drop a level and end the slice */
+    if (sched_policy == SCHED_MLFQ && --proctab[slot]->prmallot <= 0) {
+        mlfq_set_level(slot, proctab[slot]->prmlevel + 1);
+        proctab[slot]->prtime = 0;
+    }
+
+    /* Real-time: budget used up, sit out until the next release */
+    if (proctab[slot]->prrt && proccold[slot]->prbudgetleft == 0)
+        proctab[slot]->prstate = PR_WAITING;
+
+    /* Slice over, or a real-time job with an earlier deadline is ready */
+    if (proctab[slot]->prstate == PR_WAITING)
+        resched_for(TRACE_BUDGET);
+    else if (proctab[slot]->prtime == 0)
+        resched_for(TRACE_SLICE);
+    else if (this_rq()->rtq != -1 && !keeps_cpu(slot, this_rq()->rtq, TRACE_PREEMPT))
+        resched_for(TRACE_PREEMPT);
+
+    spin_unlock(&proc_lock);
 }
 
 /* Voluntarily yield CPU */
 void yield(void)
 {
     int curr_slot;
+    uint32_t mask;
     
-    if (currpid == -1)
-        return;
-    
+    mask = spin_lock_irqsave(&proc_lock);
+
     curr_slot = find_slot(currpid);
-    if (curr_slot == -1)
+    if (currpid == -1 || curr_slot == -1) {
+        spin_unlock_irqrestore(&proc_lock, mask);
         return;
+    }
+
+    /* CPU time is charged by the timer tick (sched_tick), not here */
 
-    /* Update time tracking */
-    update_process_time();
-    
     /* Apply aging to waiting processes */
     apply_aging();
+
+    mlfq_release_early(curr_slot);
     
     /* Reschedule */
-    resched();
+    resched_for(TRACE_YIELD);
+
+    spin_unlock_irqrestore(&proc_lock, mask);
 }
 
-/* Select next process based on scheduling policy */
-pid32 schedule_next(void)
+/* Sleep for 'ticks' timer ticks (0 = just yield) */
+int sleep(uint32_t ticks)
 {
-    int slot, best_slot;
-    int highest_prio;
+    int slot;
+    uint32_t mask;
 
-    if (sched_policy == SCHED_RR) {
-        /* Round-Robin: Just get next from ready queue */
-        slot = get_next_ready();
-        if (slot == -1)
-            return -1;
-        return proctab[slot].pid;
-    }
-    else if (sched_policy == SCHED_PRIO) {
-        /* Priority-based: Find highest priority ready process */
-        best_slot = -1;
-        highest_prio = -1;
-
-        /* Scan ready queue for highest priority */
-        slot = readylist.head;
-        while (slot != -1) {
-            if (proctab[slot].prstate == PR_READY) {
-                if (proctab[slot].prprio > highest_prio) {
-                    highest_prio = proctab[slot].prprio;
-                    best_slot = slot;
-                }
-            }
-            slot = proctab[slot].next;
-        }
+    if (ticks == 0) {
+        yield();
+        return 0;
+    }
 
-        if (best_slot == -1)
-            return -1;
-        
-        return proctab[best_slot].pid;
+    mask = spin_lock_irqsave(&proc_lock);
+
+    slot = find_slot(currpid);
+    if (currpid == -1 || slot == -1) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return -1;
     }
 
-    return -1;
+    mlfq_release_early(slot);
+    sleep_insert(slot, ticks);
+    proctab[slot]->prstate = PR_SLEEP;
+    resched_for(TRACE_SLEEP);
+
+    spin_unlock_irqrestore(&proc_lock, mask);
+    return 0;
+}
+
+/* Sleep for at least 'ms' milliseconds at the current tick rate */
+int sleep_ms(uint32_t ms)
+{
+    uint32_t hz = timer_get_hz();
+
+    return sleep((ms / 1000) * hz + ((ms % 1000) * hz + 999) / 1000);
+}
+
+/* Select next process based on scheduling policy */
+pid32 schedule_next(void)
+{
+    int slot = pick_next_slot(this_rq());
+
+    if (slot == -1)
+        return -1;
+    return proctab[slot]->pid;
 }
 
 /* Set time quantum for a process */
@@ -150,8 +1150,8 @@ void set_quantum(pid32 pid, int quantum)
 {
     int slot = find_slot(pid);
     if (slot != -1) {
-        proctab[slot].prquantum = quantum;
-        proctab[slot].prtime = quantum;
+        proctab[slot]->prquantum = quantum;
+        proctab[slot]->prtime = quantum;
     }
 }
 
@@ -161,37 +1161,164 @@ int get_quantum(pid32 pid)
     int slot = find_slot(pid);
     if (slot == -1)
         return -1;
-    return proctab[slot].prquantum;
+    return proctab[slot]->prquantum;
 }
 
-/* Apply aging to prevent starvation */
-void apply_aging(void)
+/* Set the stride tickets of a process (1..STRIDE_MAX_TICKETS) */
+int set_tickets(pid32 pid, int tickets)
 {
-    int i;
-    
-    for (i = 0; i < NPROC; i++) {
-        /* Only age processes in READY state */
-        if (proctab[i].prstate == PR_READY) {
-            proctab[i].prwait_time++;
-            
-            /* If waiting too long, boost priority */
-            if (proctab[i].prwait_time >= AGING_THRESHOLD) {
-                if (proctab[i].prprio < 10) {  // Cap at priority 10
-                    proctab[i].prprio += AGING_BOOST;
-                }
-                proctab[i].prwait_time = 0;  // Reset wait time
-            }
-        }
-        else if (proctab[i].prstate == PR_CURR) {
-            /* Reset wait time for running process */
-            proctab[i].prwait_time = 0;
-            
-            /* Restore original priority if it was boosted */
-            if (proctab[i].prprio > proctab[i].original_prio) {
-                proctab[i].prprio = proctab[i].original_prio;
-            }
-        }
+    int slot = find_slot(pid);
+    if (slot == -1 || tickets < 1 || tickets > STRIDE_MAX_TICKETS)
+        return -1;
+    proctab[slot]->prtickets = tickets;
+    return 0;
+}
+
+/* Get the stride tickets of a process */
+int get_tickets(pid32 pid)
+{
+    int slot = find_slot(pid);
+    if (slot == -1)
+        return -1;
+    return proctab[slot]->prtickets;
+}
+
+/* Admit a process to the real-time class: a job of 'budget' ticks is
+ * released every 'period' ticks and due 'deadline' ticks after release
+ * (0 = period). Fails if the process would push the total density past
+ * RT_UTIL_ONE. The first job is released now. */
+int set_realtime(pid32 pid, uint32_t period, uint32_t budget, uint32_t deadline)
+{
+    int slot, queued;
+    uint32_t old, util, mask, since;
+
+    if (deadline == 0)
+        deadline = period;
+    /* Periods below RT_UTIL_ONE keep the fixed point within 32 bits */
+    if (budget == 0 || budget > deadline || deadline > period || period >= RT_UTIL_ONE)
+        return -1;
+
+    mask = spin_lock_irqsave(&proc_lock);
+
+    slot = find_slot(pid);
+    if (slot == -1 || proctab[slot]->prstate == PR_DEAD) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return -1;
+    }
+
+    old = proctab[slot]->prrt ? rt_density(slot) : 0;
+    util = (budget * RT_UTIL_ONE + deadline - 1) / deadline;
+    if (rt_util - old + util > RT_UTIL_ONE) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return -1;      /* Not schedulable alongside what is admitted */
+    }
+
+    queued = (proctab[slot]->prqlevel != -1);
+    since = proctab[slot]->prready_since;
+    if (queued)
+        sched_ready_remove(slot);
+
+    rt_util += util - old;
+    proctab[slot]->prrt = 1;
+    proccold[slot]->prperiod = period;
+    proccold[slot]->prbudget = budget;
+    proccold[slot]->prdeadline = deadline;
+    rt_new_job(slot, timer_ticks);
+
+    if (queued)
+        ready_insert(slot, since);
+    else if (proctab[slot]->prstate == PR_WAITING)
+        enqueue_ready(slot);
+    else if (proctab[slot]->prstate == PR_CURR)
+        proctab[slot]->prtime = proccold[slot]->prbudgetleft;
+
+    spin_unlock_irqrestore(&proc_lock, mask);
+    return 0;
+}
+
+/* Return a real-time process to the best-effort policies */
+int clear_realtime(pid32 pid)
+{
+    int slot, queued;
+    uint32_t mask;
+
+    mask = spin_lock_irqsave(&proc_lock);
+
+    slot = find_slot(pid);
+    if (slot == -1 || !proctab[slot]->prrt) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return -1;
     }
+
+    queued = (proctab[slot]->prqlevel != -1);
+    if (queued)
+        sched_ready_remove(slot);
+    rt_release(slot);
+    if (queued || proctab[slot]->prstate == PR_WAITING)
+        enqueue_ready(slot);
+    else if (proctab[slot]->prstate == PR_CURR)
+        proctab[slot]->prtime = time_slice(slot);
+
+    spin_unlock_irqrestore(&proc_lock, mask);
+    return 0;
+}
+
+/* Real-time process: the current job is done, wait for the next one */
+void rt_wait_period(void)
+{
+    int slot;
+    uint32_t mask;
+
+    mask = spin_lock_irqsave(&proc_lock);
+
+    slot = find_slot(currpid);
+    if (currpid == -1 || slot == -1 || !proctab[slot]->prrt) {
+        spin_unlock_irqrestore(&proc_lock, mask);
+        return;
+    }
+
+    rt_list_remove(&rt_dlq, slot, 1);
+    proctab[slot]->prstate = PR_WAITING;
+    resched_for(TRACE_WAIT);
+
+    spin_unlock_irqrestore(&proc_lock, mask);
+}
+
+/* Deadlines a real-time process has missed */
+int get_deadline_misses(pid32 pid)
+{
+    int slot = find_slot(pid);
+    if (slot == -1)
+        return -1;
+    return proccold[slot]->prmisses;
+}
+
+/* Drop a process from the real-time class and give back its share
+ * (proc_lock held, process not queued) */
+void rt_release(int slot)
+{
+    if (!proctab[slot]->prrt)
+        return;
+    rt_list_remove(&rt_relq, slot, 0);
+    rt_list_remove(&rt_dlq, slot, 1);
+    rt_util -= rt_density(slot);
+    proctab[slot]->prrt = 0;
+}
+
+/* Apply aging to prevent starvation: every ready process has now waited
+ * one more unit. O(1) - the boost is applied lazily by effective_prio() */
+void apply_aging(void)
+{
+    aging_clock++;
+}
+
+/* Priority the scheduler currently sees for a process, aging included */
+int get_effective_priority(pid32 pid)
+{
+    int slot = find_slot(pid);
+    if (slot == -1)
+        return -1;
+    return effective_prio(slot);
 }
 
 /* Update time tracking for current process */
@@ -207,19 +1334,32 @@ void update_process_time(void)
         return;
     
     /* Decrement remaining time quantum */
-    if (proctab[slot].prtime > 0) {
-        proctab[slot].prtime--;
+    if (proctab[slot]->prtime > 0) {
+        proctab[slot]->prtime--;
     }
     
     /* Increment total CPU time consumed */
-    proctab[slot].prcputime++;
+    proctab[slot]->prcputime++;
+
+    /* Stride: the same tick costs less virtual time the more tickets */
+    proctab[slot]->prpass += STRIDE1 / proctab[slot]->prtickets;
+
+    /* Real-time: charge the budget of the current job */
+    if (proctab[slot]->prrt && proccold[slot]->prbudgetleft > 0)
+        proccold[slot]->prbudgetleft--;
 }
 
 /* Print scheduler statistics */
 void print_scheduler_stats(void)
 {
+    static const char *state_names[] = {
+        "free", "ready", "curr", "blocked", "waiting", "suspend", "dead", "sleep"
+    };
     int i;
-    
+    uint32_t mask;
+
+    mask = spin_lock_irqsave(&proc_lock);
+
     serial_puts("\n========================================\n");
     serial_puts("    Scheduler Statistics\n");
     serial_puts("========================================\n");
@@ -227,19 +1367,91 @@ void print_scheduler_stats(void)
     serial_puts("Policy: ");
     if (sched_policy == SCHED_RR)
         serial_puts("Round-Robin\n");
+    else if (sched_policy == SCHED_MLFQ)
+        serial_puts("Multilevel Feedback Queue\n");
+    else if (sched_policy == SCHED_STRIDE)
+        serial_puts("Stride (proportional share)\n");
     else
         serial_puts("Priority-based Round-Robin\n");
-    
-    serial_puts("\nProcess Table:\n");
-    serial_puts("PID\tState\tPrio\tCPU Time\tWait Time\n");
-    
-    for (i = 0; i < NPROC; i++) {
-        if (proctab[i].prstate != PR_FREE) {
-            /* Note: serial_puts doesn't support formatting, 
-               so we'd need to implement number printing */
-            serial_puts("Process info available\n");
+
+    serial_puts("\nCPU\tReady\tRunning PID\tTickets\tPass\n");
+    for (i = 0; i < MAX_CPUS; i++) {
+        int j, tickets = 0;
+
+        if (!cpus[i].online)
+            continue;
+        /* Stride share of this CPU: tickets of its ready and running
+         * processes, and the pass of the last one dispatched */
+        for (j = 0; j < runqs[i].nready; j++)
+            tickets += proctab[runqs[i].strideq[j]]->prtickets;
+        j = find_slot(cpus[i].cpu_currpid);
+        if (j != -1)
+            tickets += proctab[j]->prtickets;
+
+        serial_putdec(i);
+        serial_puts("\t");
+        serial_putdec(runqs[i].nready);
+        serial_puts("\t");
+        if (cpus[i].cpu_currpid == -1)
+            serial_puts("-");
+        else
+            serial_putdec(cpus[i].cpu_currpid);
+        serial_puts("\t\t");
+        serial_putdec(tickets);
+        serial_puts("\t");
+        serial_putdec(runqs[i].pass);
+        serial_puts("\n");
+    }
+
+    serial_puts("\nReal-time: ");
+    serial_putdec(rt_util * 100 / RT_UTIL_ONE);
+    serial_puts("% admitted, ");
+    serial_putdec(rt_misses);
+    serial_puts(" deadline miss(es)\n");
+    if (rt_util != 0) {
+        serial_puts("PID\tPeriod\tBudget\tDeadline\tMisses\n");
+        for (i = rt_relq; i != -1; i = proccold[i]->prrelnext) {
+            serial_putdec(proctab[i]->pid);
+            serial_puts("\t");
+            serial_putdec(proccold[i]->prperiod);
+            serial_puts("\t");
+            serial_putdec(proccold[i]->prbudget);
+            serial_puts("\t");
+            serial_putdec(proccold[i]->prdeadline);
+            serial_puts("\t\t");
+            serial_putdec(proccold[i]->prmisses);
+            serial_puts("\n");
         }
     }
     
+    /* CPU time in ticks; wait time in aging units, while ready */
+    serial_puts("\nProcess Table:\n");
+    serial_puts("PID\tState\tPrio\tCPU\tCPU Time\tWait Time\tTickets\tPass\n");
+
+    for (i = 0; i < proctab_slots; i++) {
+        if (proctab[i]->prstate == PR_FREE)
+            continue;
+        serial_putdec(proctab[i]->pid);
+        serial_puts("\t");
+        serial_puts(state_names[proctab[i]->prstate]);
+        serial_puts("\t");
+        serial_putdec(proctab[i]->prprio);
+        serial_puts("\t");
+        serial_putdec(proctab[i]->prcpu);
+        serial_puts("\t");
+        serial_putdec(proctab[i]->prcputime);
+        serial_puts("\t\t");
+        if (proctab[i]->prstate == PR_READY)
+            serial_putdec(aging_clock - proctab[i]->prready_since);
+        else
+            serial_puts("-");
+        serial_puts("\t\t");
+        serial_putdec(proctab[i]->prtickets);
+        serial_puts("\t");
+        serial_putdec(proctab[i]->prpass);
+        serial_puts("\n");
+    }
+
     serial_puts("========================================\n\n");
+    spin_unlock_irqrestore(&proc_lock, mask);
 }
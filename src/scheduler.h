@@ -7,11 +7,44 @@
 /* Scheduling Policies */
 #define SCHED_RR       0    // Round-Robin
 #define SCHED_PRIO     1    // Priority-based Round-Robin
+#define SCHED_MLFQ     2    // Multilevel feedback queue
+#define SCHED_STRIDE   3    // Stride scheduling (proportional share)
+
+/* Priority levels with their own ready queue (prprio is clamped to these) */
+#define NPRIO               32
 
 /* Default Configuration */
 #define DEFAULT_QUANTUM     10      // Default time quantum
 #define AGING_THRESHOLD     50      // Wait time before priority boost
 #define AGING_BOOST         1       // Priority increment for aging
+#define AGING_PRIO_CAP      10      // Aging stops boosting at this priority
+
+/* MLFQ: level 0 is served first; level l runs MLFQ_BASE_QUANTUM << l ticks.
+ * A process may use MLFQ_ALLOTMENT(l) ticks at level l, counted across
+ * yields; then it drops a level. One that yields or sleeps before its
+ * slice is over moves up a level with a fresh allotment. Every
+ * MLFQ_BOOST_TICKS all go back to level 0, so long-running ones cannot
+ * starve. */
+#define MLFQ_LEVELS         4
+#define MLFQ_BASE_QUANTUM   2
+#define MLFQ_ALLOTMENT(l)   (MLFQ_BASE_QUANTUM << (l))
+#define MLFQ_BOOST_TICKS    200
+
+/* Stride: each tick of CPU time advances a process's pass by
+ * STRIDE1 / prtickets and the lowest pass runs next, so CPU shares
+ * follow the ticket ratios. Slices are one tick for a fine-grained mix. */
+#define STRIDE1                 (1 << 16)
+#define STRIDE_DEFAULT_TICKETS  100
+#define STRIDE_MAX_TICKETS      STRIDE1
+#define STRIDE_QUANTUM          1
+
+/* Real-time (EDF) class, ahead of every policy above: a process with a
+ * period, a per-job budget and a relative deadline (all in ticks) is
+ * admitted only while the summed density budget / min(deadline, period)
+ * stays within 1. Ready real-time processes run earliest deadline first;
+ * one that uses up its budget waits for its next release. Utilization
+ * is kept in fixed point, RT_UTIL_ONE being 100%. */
+#define RT_UTIL_ONE             (1 << 16)
 
 /* Current scheduling policy */
 extern int sched_policy;
@@ -22,13 +55,44 @@ void resched(void);
 void yield(void);
 pid32 schedule_next(void);
 void user_process_exit(void);  // Called when process function returns
+void sched_run(void);          // Run processes until none is ready
+void sched_idle(void);         // Idle loop of an application processor
+void sched_tick(void);         // Timer interrupt hook (preemption)
+void sched_proc_entry(void);   // First code of a new process (proc_start)
+int sched_home_cpu(void);      // CPU whose run queue takes a new process
+
+/* Per-CPU ready queues (called by process.c as processes become ready
+ * or stop being ready) */
+void sched_ready_insert(int slot);
+void sched_ready_remove(int slot);
+int sched_ready_head(int cpu);         // Oldest ready process on cpu, -1 if none
+int sched_ready_count(void);           // Ready processes over all CPUs
+void sched_sleep_remove(int slot);     // Terminating a sleeper (proc_lock held)
+
+/* Timed sleep: the process leaves the ready queues until the tick it
+ * is due, kept on a delta list so a tick only looks at the head.
+ * Return 0, or -1 if not called from a process. */
+int sleep(uint32_t ticks);
+int sleep_ms(uint32_t ms);
 
 /* Time Quantum Management */
 void set_quantum(pid32 pid, int quantum);
 int get_quantum(pid32 pid);
 
-/* Aging Mechanism */
+/* Stride tickets (CPU share under SCHED_STRIDE) */
+int set_tickets(pid32 pid, int tickets);
+int get_tickets(pid32 pid);
+
+/* Real-time class (0 on success, -1 if not admitted / not real-time) */
+int set_realtime(pid32 pid, uint32_t period, uint32_t budget, uint32_t deadline);
+int clear_realtime(pid32 pid);
+void rt_wait_period(void);     // Current job is done, wait for the next release
+int get_deadline_misses(pid32 pid);
+void rt_release(int slot);     // Called by proc_release() (proc_lock held)
+
+/* Aging Mechanism (lazy: effective priority is derived from wait time) */
 void apply_aging(void);
+int get_effective_priority(pid32 pid);
 
 /* Time Tracking */
 void update_process_time(void);
@@ -1,9 +1,13 @@
 /* serial.c - Serial port driver (COM1) */
 #include "serial.h"
 #include "io.h"
+#include "spinlock.h"
 
 #define COM1 0x3F8   /* I/O port base address for COM1 */
 
+/* Keeps strings from different CPUs from interleaving */
+static spinlock_t serial_lock = SPINLOCK_INIT;
+
 /*
 You can find more information here: https://caro.su/msx/ocm_de1/16550.pdf
 
@@ -45,9 +49,41 @@ void serial_putc(char c) {
 }
 
 void serial_puts(const char* str) {
+    uint32_t mask = spin_lock_irqsave(&serial_lock);
     while (*str) {
         serial_putc(*str++);
     }
+    spin_unlock_irqrestore(&serial_lock, mask);
+}
+
+/* Print an unsigned value in decimal */
+void serial_putdec(uint32_t val) {
+    char buf[11];
+    int i = 0;
+
+    do {
+        buf[i++] = '0' + (val % 10);
+        val /= 10;
+    } while (val);
+
+    while (i > 0) {
+        serial_putc(buf[--i]);
+    }
+}
+
+/* Print the low 'width' hex digits of a value, zero-padded, no prefix */
+void serial_puthex_width(uint32_t val, int width) {
+    const char* digits = "0123456789ABCDEF";
+
+    for (int shift = (width - 1) * 4; shift >= 0; shift -= 4) {
+        serial_putc(digits[(val >> shift) & 0xF]);
+    }
+}
+
+/* Print an unsigned value as 0x-prefixed hex */
+void serial_puthex(uint32_t val) {
+    serial_puts("0x");
+    serial_puthex_width(val, 8);
 }
 
 static int serial_received(void) {
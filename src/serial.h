@@ -7,6 +7,9 @@
 void serial_init(void);
 void serial_putc(char c);
 void serial_puts(const char* str);
+void serial_putdec(uint32_t val);
+void serial_puthex(uint32_t val);
+void serial_puthex_width(uint32_t val, int width);
 char serial_getc(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+/* smp.c - Application processor bring-up
+ *
+ * APs are woken with a broadcast INIT-SIPI-SIPI, so no firmware tables
+ * are needed: every CPU that answers takes the next index in cpus[].
+ * Once online an AP runs the scheduler's idle loop, taking processes
+ * from its own run queue or stealing from busier CPUs.
+ */
+#include "smp.h"
+#include "gdt.h"
+#include "idt.h"
+#include "lapic.h"
+#include "timer.h"
+#include "cpu.h"
+#include "string.h"
+#include "serial.h"
+#include "scheduler.h"
+#include "fpu.h"
+
+#define AP_WAIT_TICKS   10      /* How long to wait for APs to check in */
+
+cpu_t cpus[MAX_CPUS] = { [0] = { .online = 1 } };   /* BSP runs from boot */
+volatile int ncpus = 1;
+
+/* From ap_boot.S */
+extern uint8_t ap_trampoline[], ap_trampoline_end[];
+extern uint32_t ap_tramp_count, ap_tramp_stacks, ap_tramp_entry;
+
+static uint8_t ap_stacks[MAX_CPUS][AP_STACK_SIZE] __attribute__((aligned(16)));
+
+/* Address of a trampoline variable in the low-memory copy */
+static volatile uint32_t* tramp_var(uint32_t* var) {
+    return (volatile uint32_t*)(AP_TRAMPOLINE + ((uint8_t*)var - ap_trampoline));
+}
+
+/* First C code on an AP, on its ap_stacks[] entry */
+static void ap_main(int id) {
+    gdt_load(id);
+    idt_load();
+    fpu_init();
+    lapic_init();
+    cpus[id].apic_id = lapic_id();
+    lapic_timer_start();
+
+    cpus[id].online = 1;
+    __sync_fetch_and_add(&ncpus, 1);
+
+    sched_idle();   /* Never returns */
+}
+
+void smp_init(void) {
+    uint32_t start;
+
+    if (!lapic_present()) {
+        serial_puts("[SMP] No local APIC, running on one CPU\n");
+        return;
+    }
+
+    lapic_init();
+    cpus[0].apic_id = lapic_id();
+    lapic_timer_calibrate();
+
+    memcpy((void*)AP_TRAMPOLINE, ap_trampoline, ap_trampoline_end - ap_trampoline);
+    *tramp_var(&ap_tramp_count) = 1;
+    *tramp_var(&ap_tramp_stacks) = (uint32_t)ap_stacks;
+    *tramp_var(&ap_tramp_entry) = (uint32_t)ap_main;
+
+    lapic_start_aps(AP_TRAMPOLINE);
+
+    /* APs check in within microseconds; give them plenty of time */
+    start = timer_ticks;
+    while (timer_ticks - start < AP_WAIT_TICKS)
+        __asm__ volatile ("hlt");
+
+    serial_puts("[SMP] ");
+    serial_putdec(ncpus);
+    serial_puts(" CPU(s) online\n");
+}
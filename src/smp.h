@@ -0,0 +1,35 @@
+/* smp.h - Per-CPU state and application processor bring-up */
+#ifndef SMP_H
+#define SMP_H
+
+#include "types.h"
+
+#define MAX_CPUS        8
+#define AP_STACK_SIZE   4096        /* Boot/idle stack of each AP */
+#define AP_TRAMPOLINE   0x8000      /* Real-mode entry page (ap_boot.S) */
+
+typedef struct cpu {
+    struct cpu* self;       /* Read through %fs:0 by cpu_self() */
+    int id;                 /* Index in cpus[] (0 = bootstrap CPU) */
+    uint32_t apic_id;       /* Local APIC ID */
+    volatile int online;    /* Set once the CPU is scheduling */
+    int cpu_currpid;        /* Process running on this CPU (-1 = none) */
+    int fpu_owner;          /* Slot whose state the FPU registers hold (-1 = none) */
+    int fpu_live;           /* CR0.TS clear: the FPU is in use since the last switch */
+} cpu_t;
+
+extern cpu_t cpus[MAX_CPUS];
+extern volatile int ncpus;  /* CPUs online, including the bootstrap CPU */
+
+/* Every CPU's %fs segment covers its own cpu_t (see gdt.c) */
+static inline cpu_t* cpu_self(void) {
+    cpu_t* c;
+    __asm__ volatile ("movl %%fs:0, %0" : "=r"(c));
+    return c;
+}
+
+/* Start the application processors; they enter the scheduler's idle
+ * loop and pick up work from the run queues */
+void smp_init(void);
+
+#endif
@@ -0,0 +1,39 @@
+/* spinlock.h - Spinlocks for state shared between CPUs */
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "types.h"
+#include "cpu.h"
+
+typedef struct spinlock {
+    volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline void spin_lock(spinlock_t* lock) {
+    /* Test-and-test-and-set: spin on a plain read, xchg only when free */
+    while (__sync_lock_test_and_set(&lock->locked, 1)) {
+        while (lock->locked)
+            __asm__ volatile ("pause");
+    }
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    __sync_lock_release(&lock->locked);
+}
+
+/* Lock with interrupts off on this CPU, so a handler on the same CPU
+ * cannot spin on a lock its own interrupted code holds */
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = irq_disable();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+#endif
@@ -1,15 +1,59 @@
 /* string.c - String utility implementations */
 #include "string.h"
 
+/* Word view of byte buffers; may_alias keeps -O2 from assuming char
+ * data and uint32_t loads never overlap */
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+#define ONES  0x01010101u
+#define HIGHS 0x80808080u
+
+/* Non-zero if any byte of w is zero */
+static inline uint32_t has_zero(uint32_t w) {
+    return (w - ONES) & ~w & HIGHS;
+}
+
 size_t strlen(const char* str) {
-    size_t len = 0;
-    while (str[len]) {
-        len++;
+    const char* p = str;
+
+    /* Byte steps until aligned; aligned word loads never cross a page */
+    while ((uint32_t)p & 3) {
+        if (!*p)
+            return p - str;
+        p++;
     }
-    return len;
+
+    const word_t* w = (const word_t*)p;
+    while (!has_zero(*w))
+        w++;
+
+    p = (const char*)w;
+    while (*p)
+        p++;
+    return p - str;
 }
 
 int strcmp(const char* str1, const char* str2) {
+    /* Compare a word at a time when both strings share an alignment */
+    if ((((uint32_t)str1 ^ (uint32_t)str2) & 3) == 0) {
+        while ((uint32_t)str1 & 3) {
+            if (!*str1 || *str1 != *str2)
+                goto bytes;
+            str1++;
+            str2++;
+        }
+
+        const word_t* w1 = (const word_t*)str1;
+        const word_t* w2 = (const word_t*)str2;
+        while (*w1 == *w2 && !has_zero(*w1)) {
+            w1++;
+            w2++;
+        }
+        str1 = (const char*)w1;
+        str2 = (const char*)w2;
+    }
+
+bytes:
     while (*str1 && (*str1 == *str2)) {
         str1++;
         str2++;
@@ -18,7 +62,97 @@ int strcmp(const char* str1, const char* str2) {
 }
 
 char* strcpy(char* dest, const char* src) {
-    char* original_dest = dest;
-    while ((*dest++ = *src++));
-    return original_dest;
-}
\ No newline at end of file
+    memcpy(dest, src, strlen(src) + 1);
+    return dest;
+}
+
+void* memcpy(void* dest, const void* src, size_t n) {
+    void* ret = dest;
+
+    /* Align the destination so the bulk moves are aligned stores */
+    if (n >= 16) {
+        size_t head = (-(uint32_t)dest) & 3;
+        n -= head;
+        __asm__ volatile ("rep movsb"
+                          : "+D"(dest), "+S"(src), "+c"(head) : : "memory");
+    }
+
+    size_t words = n >> 2;
+    size_t tail = n & 3;
+    __asm__ volatile ("rep movsl\n\t"
+                      "movl %3, %%ecx\n\t"
+                      "rep movsb"
+                      : "+D"(dest), "+S"(src), "+c"(words)
+                      : "r"(tail)
+                      : "memory");
+    return ret;
+}
+
+void* memmove(void* dest, const void* src, size_t n) {
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+
+    /* Forward copy is safe unless dest overlaps the end of src */
+    if (d <= s || d >= s + n)
+        return memcpy(dest, src, n);
+
+    /* Backwards: trailing bytes first, then whole words with DF set */
+    d += n;
+    s += n;
+    size_t tail = n & 3;
+    while (tail--)
+        *--d = *--s;
+
+    size_t words = n >> 2;
+    if (words) {
+        d -= 4;
+        s -= 4;
+        __asm__ volatile ("std\n\t"
+                          "rep movsl\n\t"
+                          "cld"
+                          : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+    }
+    return dest;
+}
+
+void* memset(void* dest, int c, size_t n) {
+    void* ret = dest;
+    uint32_t fill = (uint8_t)c * ONES;
+
+    if (n >= 16) {
+        size_t head = (-(uint32_t)dest) & 3;
+        n -= head;
+        __asm__ volatile ("rep stosb"
+                          : "+D"(dest), "+c"(head) : "a"(fill) : "memory");
+    }
+
+    size_t words = n >> 2;
+    size_t tail = n & 3;
+    __asm__ volatile ("rep stosl\n\t"
+                      "movl %2, %%ecx\n\t"
+                      "rep stosb"
+                      : "+D"(dest), "+c"(words)
+                      : "r"(tail), "a"(fill)
+                      : "memory");
+    return ret;
+}
+
+int memcmp(const void* s1, const void* s2, size_t n) {
+    const uint8_t* p1 = (const uint8_t*)s1;
+    const uint8_t* p2 = (const uint8_t*)s2;
+
+    /* Skip equal words; x86 tolerates the unaligned loads */
+    while (n >= 4 && *(const word_t*)p1 == *(const word_t*)p2) {
+        p1 += 4;
+        p2 += 4;
+        n -= 4;
+    }
+
+    while (n--) {
+        if (*p1 != *p2)
+            return *p1 - *p2;
+        p1++;
+        p2++;
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+/* timer.c - Programmable interval timer driving the scheduler tick */
+#include "timer.h"
+#include "idt.h"
+#include "io.h"
+#include "scheduler.h"
+
+#define PIT_CHANNEL0    0x40
+#define PIT_CMD         0x43
+#define PIT_MODE3       0x36    /* Channel 0, lo/hi byte, square wave */
+
+volatile uint32_t timer_ticks = 0;
+static uint32_t timer_hz = 0;
+
+static void timer_handler(int_frame_t* frame) {
+    (void)frame;
+    timer_ticks++;
+    sched_tick();
+}
+
+void timer_init(uint32_t hz) {
+    uint32_t divisor;
+
+    /* The 16-bit divisor limits the rate to roughly 19 Hz - 1.19 MHz */
+    if (hz < 19)
+        hz = 19;
+    if (hz > PIT_BASE_HZ)
+        hz = PIT_BASE_HZ;
+
+    divisor = PIT_BASE_HZ / hz;
+    timer_hz = PIT_BASE_HZ / divisor;
+
+    outb(PIT_CMD, PIT_MODE3);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, (divisor >> 8) & 0xFF);
+
+    irq_register(0, timer_handler);
+}
+
+uint32_t timer_get_hz(void) {
+    return timer_hz;
+}
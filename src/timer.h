@@ -0,0 +1,17 @@
+/* timer.h - Programmable interval timer (8253/8254 PIT) */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+
+#define PIT_BASE_HZ     1193182     /* PIT input clock */
+#define TIMER_HZ        100         /* Default tick rate */
+
+/* Ticks since timer_init() */
+extern volatile uint32_t timer_ticks;
+
+/* Program channel 0 for 'hz' interrupts per second and hook IRQ 0 */
+void timer_init(uint32_t hz);
+uint32_t timer_get_hz(void);
+
+#endif
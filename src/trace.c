@@ -0,0 +1,77 @@
+/* trace.c - Scheduler trace dump (recording is inline in trace.h) */
+#include "trace.h"
+#include "serial.h"
+
+trace_ring_t trace_rings[MAX_CPUS];
+int trace_enabled = 1;
+
+static const char trace_reason_code[] = "CYSPBWXIZ";
+
+/* Copy of one ring, taken while its CPU keeps writing */
+static trace_entry_t trace_copy[TRACE_ENTRIES];
+
+static void put_pid(int pid)
+{
+    if (pid < 0)
+        serial_putc('-');
+    else
+        serial_putdec(pid);
+}
+
+/* Format: "T <cpu> <tsc hex> <old pid> <new pid> <reason> <ready>" */
+void trace_dump(void)
+{
+    int c;
+
+    serial_puts("trace begin\n");
+    for (c = 0; c < MAX_CPUS; c++) {
+        trace_ring_t *r = &trace_rings[c];
+        uint32_t first, last, i, n = 0;
+
+        if (!cpus[c].online)
+            continue;
+
+        last = r->head;
+        first = r->start;
+        if (last - first > TRACE_ENTRIES)
+            first = last - TRACE_ENTRIES;
+        for (i = first; i != last; i++)
+            trace_copy[n++] = r->ent[i & (TRACE_ENTRIES - 1)];
+
+        /* Entries the writer has lapped during the copy are garbage,
+         * and so is the slot it may be filling right now (head) */
+        __asm__ volatile ("" : : : "memory");
+        if (r->head + 1 - first > TRACE_ENTRIES) {
+            uint32_t lost = r->head + 1 - first - TRACE_ENTRIES;
+            i = lost < n ? lost : n;
+        } else {
+            i = 0;
+        }
+
+        for (; i < n; i++) {
+            trace_entry_t *e = &trace_copy[i];
+            serial_puts("T ");
+            serial_putdec(c);
+            serial_putc(' ');
+            serial_puthex_width((uint32_t)(e->tsc >> 32), 8);
+            serial_puthex_width((uint32_t)e->tsc, 8);
+            serial_putc(' ');
+            put_pid(e->old_pid);
+            serial_putc(' ');
+            put_pid(e->new_pid);
+            serial_putc(' ');
+            serial_putc(e->reason < sizeof(trace_reason_code) - 1 ?
+                        trace_reason_code[e->reason] : '?');
+            serial_putc(' ');
+            serial_putdec(e->nready);
+            serial_putc('\n');
+        }
+    }
+    serial_puts("trace end\n");
+}
+
+void trace_clear(void)
+{
+    for (int c = 0; c < MAX_CPUS; c++)
+        trace_rings[c].start = trace_rings[c].head;
+}
@@ -0,0 +1,74 @@
+/* trace.h - Scheduler trace: every resched decision in a per-CPU ring
+ *
+ * Each CPU writes only its own ring, always with interrupts off inside
+ * the scheduler, so recording needs no lock or atomic operation: fill
+ * the slot, then publish it by advancing 'head'. Readers copy a ring
+ * and drop whatever the writer lapped in the meantime. tools/sched_trace.py
+ * turns a dump into run and wait latency histograms.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+#include "cpu.h"
+#include "smp.h"
+
+#define TRACE_ENTRIES   256     /* Per CPU, power of two */
+
+/* Why the scheduler was entered (letter in the dump) */
+#define TRACE_CALL      0       /* C: direct resched() */
+#define TRACE_YIELD     1       /* Y: yield() */
+#define TRACE_SLICE     2       /* S: quantum used up */
+#define TRACE_PREEMPT   3       /* P: earlier real-time deadline ready */
+#define TRACE_BUDGET    4       /* B: real-time budget used up */
+#define TRACE_WAIT      5       /* W: real-time job done */
+#define TRACE_EXIT      6       /* X: process exited */
+#define TRACE_IDLE      7       /* I: dispatch from the idle/scheduler loop */
+#define TRACE_SLEEP     8       /* Z: sleep() */
+
+typedef struct trace_entry {
+    uint64_t tsc;           /* Timestamp counter at the decision */
+    int old_pid;            /* Running before (-1 = none) */
+    int new_pid;            /* Running after (-1 = back to the loop) */
+    uint16_t nready;        /* Processes queued on this CPU */
+    uint8_t reason;         /* TRACE_* */
+} trace_entry_t;
+
+typedef struct trace_ring {
+    volatile uint32_t head;     /* Entries ever written */
+    uint32_t start;             /* First entry to dump (trace_clear) */
+    trace_entry_t ent[TRACE_ENTRIES];
+} trace_ring_t;
+
+extern trace_ring_t trace_rings[MAX_CPUS];
+extern int trace_enabled;
+
+/* Record one decision on this CPU (interrupts off) */
+static inline void trace_switch(int reason, int old_pid, int new_pid, int nready)
+{
+    trace_ring_t *r;
+    trace_entry_t *e;
+    uint32_t h;
+
+    if (!trace_enabled)
+        return;
+
+    r = &trace_rings[cpu_self()->id];
+    h = r->head;
+    e = &r->ent[h & (TRACE_ENTRIES - 1)];
+    e->tsc = rdtsc64();
+    e->old_pid = old_pid;
+    e->new_pid = new_pid;
+    e->nready = nready;
+    e->reason = reason;
+    __asm__ volatile ("" : : : "memory");   /* Entry before head */
+    r->head = h + 1;
+}
+
+/* Print every CPU's ring, oldest first, one compact line per entry */
+void trace_dump(void);
+
+/* Forget what has been recorded so far */
+void trace_clear(void);
+
+#endif
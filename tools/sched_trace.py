@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Per-process run and wait latency histograms from a kacchiOS scheduler trace.
+
+Capture the serial output of the "trace" shell command (everything between
+"trace begin" and "trace end"; other lines are ignored) and feed it in:
+
+    make run | tee serial.log          # type "trace" at the prompt
+    tools/sched_trace.py serial.log --mhz 2400
+
+Each trace line is "T <cpu> <tsc hex> <old pid> <new pid> <reason> <ready>".
+Run time is from a process being switched in to being switched out. Wait
+time is from being preempted or yielding (still ready) to the next switch
+in. Without --mhz times are in TSC cycles.
+"""
+import argparse
+import sys
+from collections import defaultdict
+
+# Reasons after which the old process is still ready (see trace.h)
+STILL_READY = set("CYSP")
+
+
+def parse(lines):
+    events = []
+    for line in lines:
+        f = line.split()
+        if len(f) != 7 or f[0] != "T":
+            continue
+        cpu, tsc, old, new, reason, nready = f[1:]
+        pid = lambda s: None if s == "-" else int(s)
+        events.append((int(tsc, 16), int(cpu), pid(old), pid(new), reason, int(nready)))
+    # CPUs are dumped one after another; merge them by time
+    events.sort(key=lambda e: e[0])
+    return events
+
+
+def latencies(events):
+    run = defaultdict(list)
+    wait = defaultdict(list)
+    running = {}        # cpu -> (pid, switched in at)
+    ready_since = {}    # pid -> tsc
+
+    for tsc, cpu, old, new, reason, _ in events:
+        if old == new:
+            continue    # Running process kept the CPU
+        if old is not None:
+            cur = running.pop(cpu, None)
+            if cur and cur[0] == old:
+                run[old].append(tsc - cur[1])
+            if reason in STILL_READY:
+                ready_since[old] = tsc
+        if new is not None:
+            running[cpu] = (new, tsc)
+            if new in ready_since:
+                wait[new].append(tsc - ready_since.pop(new))
+    return run, wait
+
+
+def histogram(title, samples, scale, unit):
+    print("  %s: %d samples, min %.1f, max %.1f %s" % (
+        title, len(samples), min(samples) / scale, max(samples) / scale, unit))
+    buckets = defaultdict(int)
+    for s in samples:
+        buckets[max(int(s / scale), 1).bit_length() - 1] += 1
+    width = max(buckets.values())
+    for b in range(min(buckets), max(buckets) + 1):
+        n = buckets.get(b, 0)
+        lo = 0 if b == 0 else 1 << b
+        print("    [%8d, %8d) %6d %s" % (lo, 2 << b, n, "#" * (40 * n // width)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    ap.add_argument("--mhz", type=float, help="TSC frequency, to report microseconds")
+    args = ap.parse_args()
+
+    lines = open(args.log) if args.log else sys.stdin
+    events = parse(lines)
+    if not events:
+        sys.exit("no trace lines found")
+
+    scale, unit = (args.mhz, "us") if args.mhz else (1.0, "cycles")
+    run, wait = latencies(events)
+    print("%d decisions, %d processes" % (len(events), len(set(run) | set(wait))))
+    for pid in sorted(set(run) | set(wait)):
+        print("pid %d" % pid)
+        if run[pid]:
+            histogram("run", run[pid], scale, unit)
+        if wait[pid]:
+            histogram("wait", wait[pid], scale, unit)
+
+
+if __name__ == "__main__":
+    main()